@@ -0,0 +1,320 @@
+// Measurement core of the ESPHost EMAC benchmark
+//
+// ESPHostBenchmark.ino runs it with the sockets of the Mbed Core WiFi library.
+// extras/host/benchmark.cpp runs the same code with the sockets of the host
+// build against a simulated ESP and peer, so a driver change can be measured
+// on the board and on the host the same way.
+
+#ifndef BENCHMARK_CORE_H_
+#define BENCHMARK_CORE_H_
+
+#include <limits.h>
+#include <Arduino.h>
+#include <ESPHostEMAC.h>
+
+const uint16_t IPERF_PORT = 5001;
+const uint16_t ECHO_PORT = 7;
+const unsigned long TEST_DURATION = 10000;
+const unsigned long TCP_IDLE_TIMEOUT = 3000;  // ms without data to give up a half-open connection
+const unsigned long ECHO_TIMEOUT = 1000000;   // us to wait for an echo reply
+const size_t BULK_SIZE = 1460;
+const size_t SMALL_SIZE = 64;
+const int ECHO_COUNT = 100;
+const int IPERF_FIN_COUNT = 10;               // final datagrams sent until the iperf server reports
+const unsigned long IPERF_FIN_WAIT = 250;     // ms to wait for the report after each
+
+/** Result of a benchmark test */
+struct BenchmarkResult {
+  bool ok;                // false if there was no peer
+  unsigned long bytes;
+  unsigned long packets;
+  unsigned long elapsed;  // ms
+  int replies;            // UDP echo replies to their own probe
+  int stale;              // UDP echo replies to an earlier probe, not counted
+  unsigned long rttMin;   // us
+  unsigned long rttAvg;
+  unsigned long rttMax;
+  ESPHostEMACStats emac;  // EMAC counters during the test
+};
+
+/** Benchmark
+ *  The tests over the socket types of the platform. Client, Server and UDP
+ *  have the API of WiFiClient, WiFiServer and WiFiUDP of the Arduino core.
+ */
+template<class Client, class Server, class UDP>
+class Benchmark {
+public:
+
+  Benchmark(Server &server, UDP &udp, Print &out, IPAddress peer) :
+      server(server), udp(udp), out(out), peer(peer) {
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+      buffer[i] = i;
+    }
+  }
+
+  /** Run the test of the mode character, prints the result and the EMAC counters */
+  BenchmarkResult run(char mode) {
+    BenchmarkResult r;
+    memset(&r, 0, sizeof(r));
+    ESPHostEMACStats before;
+    ESPHostEMAC::get_instance().get_stats(before);
+    switch (mode) {
+      case 't': tcpSend(r); break;
+      case 'r': tcpReceive(r); break;
+      case 'u': udpSend(r, BULK_SIZE, "UDP TX"); break;
+      case 'v': udpReceive(r); break;
+      case 'e': udpEcho(r); break;
+      case 'p': udpSend(r, SMALL_SIZE, "UDP pps"); break;
+      default: printHelp(); return r;
+    }
+    ESPHostEMAC::get_instance().get_stats(r.emac);
+    r.emac.rx_frames -= before.rx_frames;
+    r.emac.rx_bytes -= before.rx_bytes;
+    r.emac.rx_pauses -= before.rx_pauses;
+    r.emac.tx_frames -= before.tx_frames;
+    r.emac.tx_bytes -= before.tx_bytes;
+    r.emac.tx_errors -= before.tx_errors;
+    r.emac.wakeups -= before.wakeups;
+    printStats(r.emac);
+    return r;
+  }
+
+  void printHelp() {
+    out.println("t: TCP TX, r: TCP RX, u: UDP TX, v: UDP RX, e: UDP echo RTT, p: UDP small packet rate");
+  }
+
+private:
+
+  void tcpSend(BenchmarkResult &r) {
+    Client client;
+    if (!client.connect(peer, IPERF_PORT)) {
+      out.println("TCP TX: connection failed");
+      return;
+    }
+    r.ok = true;
+    unsigned long start = millis();
+    while (millis() - start < TEST_DURATION && client.connected()) {
+      r.bytes += client.write(buffer, sizeof(buffer));
+    }
+    r.elapsed = millis() - start;
+    client.stop();
+    printRate("TCP TX", r);
+  }
+
+  // a peer which disappears without closing leaves the connection half-open,
+  // so the test ends after TCP_IDLE_TIMEOUT without data
+  void tcpReceive(BenchmarkResult &r) {
+    out.println("TCP RX: waiting for a client");
+    Client client;
+    unsigned long wait = millis();
+    while (!(client = server.accept())) {
+      if (millis() - wait > TEST_DURATION) {
+        out.println("TCP RX: no client");
+        return;
+      }
+    }
+    r.ok = true;
+    unsigned long start = millis();
+    unsigned long last = start;
+    while (client.connected() || client.available()) {
+      int n = client.read(buffer, sizeof(buffer));
+      if (n > 0) {
+        r.bytes += n;
+        last = millis();
+      } else if (millis() - last > TCP_IDLE_TIMEOUT) {
+        out.println("TCP RX: no data from the client, closing");
+        break;
+      }
+    }
+    r.elapsed = last - start;
+    client.stop();
+    printRate("TCP RX", r);
+  }
+
+  // the datagrams start with the header of an iperf2 client: the sequence number
+  // and the send time, in network byte order. Like the iperf2 client, the test
+  // ends with a datagram with the negated sequence number, repeated until the
+  // server answers with its report.
+  void udpSend(BenchmarkResult &r, size_t size, const char *name) {
+    udp.begin(IPERF_PORT);
+    r.ok = true;
+    unsigned long start = millis();
+    while (millis() - start < TEST_DURATION) {
+      iperfHeader(r.packets);
+      udp.beginPacket(peer, IPERF_PORT);
+      udp.write(buffer, size);
+      if (udp.endPacket()) {
+        r.bytes += size;
+        r.packets++;
+      }
+    }
+    r.elapsed = millis() - start;
+    bool reported = false;
+    for (int i = 0; i < IPERF_FIN_COUNT && !reported; i++) {
+      iperfHeader(-(int32_t) r.packets);
+      udp.beginPacket(peer, IPERF_PORT);
+      udp.write(buffer, size);
+      udp.endPacket();
+      unsigned long wait = millis();
+      while (!reported && millis() - wait < IPERF_FIN_WAIT) {
+        reported = (udp.parsePacket() > 0);
+      }
+    }
+    udp.stop();
+    printRate(name, r);
+    if (!reported) {
+      out.print(name);
+      out.println(": no report from the iperf server");
+    }
+  }
+
+  void iperfHeader(int32_t seq) {
+    unsigned long now = micros();
+    putUint32(buffer, seq);
+    putUint32(buffer + 4, now / 1000000);
+    putUint32(buffer + 8, now % 1000000);
+  }
+
+  static void putUint32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+  }
+
+  void udpReceive(BenchmarkResult &r) {
+    udp.begin(IPERF_PORT);
+    out.println("UDP RX: waiting for datagrams");
+    unsigned long start = 0;
+    unsigned long last = millis();
+    // the test ends one second after the last datagram
+    while (millis() - last < 1000 || (start == 0 && millis() - last < TEST_DURATION)) {
+      int size = udp.parsePacket();
+      if (size > 0) {
+        last = millis();
+        if (start == 0) {
+          start = last;
+        }
+        udp.read(buffer, sizeof(buffer));
+        r.bytes += size;
+        r.packets++;
+      }
+    }
+    udp.stop();
+    if (start == 0) {
+      out.println("UDP RX: no datagrams");
+      return;
+    }
+    r.ok = true;
+    r.elapsed = last - start;
+    printRate("UDP RX", r);
+  }
+
+  // each probe carries its sequence number, so a reply arriving after the
+  // timeout of its probe isn't taken for the reply to the next one
+  void udpEcho(BenchmarkResult &r) {
+    udp.begin(ECHO_PORT);
+    unsigned long sumRtt = 0;
+    r.rttMin = ULONG_MAX;
+    for (int i = 0; i < ECHO_COUNT; i++) {
+      uint32_t seq = i;
+      memcpy(buffer, &seq, sizeof(seq));
+      unsigned long start = micros();
+      udp.beginPacket(peer, ECHO_PORT);
+      udp.write(buffer, SMALL_SIZE);
+      udp.endPacket();
+      while (micros() - start < ECHO_TIMEOUT) {
+        if (udp.parsePacket() <= 0)
+          continue;
+        unsigned long rtt = micros() - start;
+        uint32_t replySeq = ~seq;
+        if (udp.read(buffer, sizeof(buffer)) >= (int) sizeof(replySeq)) {
+          memcpy(&replySeq, buffer, sizeof(replySeq));
+        }
+        if (replySeq != seq) {
+          r.stale++;
+          continue;
+        }
+        if (rtt < r.rttMin) {
+          r.rttMin = rtt;
+        }
+        if (rtt > r.rttMax) {
+          r.rttMax = rtt;
+        }
+        sumRtt += rtt;
+        r.replies++;
+        break;
+      }
+    }
+    udp.stop();
+    r.ok = (r.replies > 0);
+    out.print("UDP echo: ");
+    out.print(r.replies);
+    out.print("/");
+    out.print(ECHO_COUNT);
+    out.print(" replies");
+    if (r.stale > 0) {
+      out.print(", ");
+      out.print(r.stale);
+      out.print(" late replies ignored");
+    }
+    out.println();
+    if (r.replies > 0) {
+      r.rttAvg = sumRtt / r.replies;
+      out.print("  RTT min/avg/max: ");
+      out.print(r.rttMin);
+      out.print("/");
+      out.print(r.rttAvg);
+      out.print("/");
+      out.print(r.rttMax);
+      out.println(" us");
+    } else {
+      r.rttMin = 0;
+    }
+  }
+
+  void printRate(const char *name, const BenchmarkResult &r) {
+    unsigned long elapsed = r.elapsed ? r.elapsed : 1;
+    out.print(name);
+    out.print(": ");
+    out.print(r.bytes);
+    out.print(" bytes in ");
+    out.print(elapsed);
+    out.print(" ms, ");
+    out.print(r.bytes * 8.0 / elapsed / 1000.0);
+    out.print(" Mbit/s");
+    if (r.packets > 0) {
+      out.print(", ");
+      out.print(r.packets * 1000.0 / elapsed);
+      out.print(" packets/s");
+    }
+    out.println();
+  }
+
+  void printStats(const ESPHostEMACStats &s) {
+    out.print("  EMAC rx frames/bytes: ");
+    out.print(s.rx_frames);
+    out.print("/");
+    out.print(s.rx_bytes);
+    out.print(", tx frames/bytes: ");
+    out.print(s.tx_frames);
+    out.print("/");
+    out.print(s.tx_bytes);
+    out.println();
+    out.print("  EMAC tx errors: ");
+    out.print(s.tx_errors);
+    out.print(", rx pauses: ");
+    out.print(s.rx_pauses);
+    out.print(", wakeups: ");
+    out.print(s.wakeups);
+    out.println();
+  }
+
+  Server &server;
+  UDP &udp;
+  Print &out;
+  IPAddress peer;
+  uint8_t buffer[BULK_SIZE];
+};
+
+#endif
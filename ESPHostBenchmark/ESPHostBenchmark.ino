@@ -0,0 +1,75 @@
+/*
+  ESPHost EMAC Benchmark
+
+ Measures the throughput and the latency of the ESPHost EMAC driver against
+ a peer on the local network, and prints the results together with the
+ counters of the EMAC (frames, bytes, errors, RX pauses and receive task
+ wakeups) so that numbers can be compared across driver changes.
+
+ Send one of the following characters over the Serial Monitor:
+ t  TCP bulk TX to an iperf server     (peer: iperf -s -p 5001)
+ r  TCP bulk RX from an iperf client   (peer: iperf -c <board ip> -p 5001)
+ u  UDP bulk TX                        (peer: iperf -s -u -p 5001)
+ v  UDP bulk RX                        (peer: iperf -c <board ip> -u -b 20M -p 5001)
+ e  UDP echo round trip time           (peer: any UDP echo server on port 7)
+ p  small packet rate, 64 byte UDP     (peer: iperf -s -u -p 5001)
+
+ Every test runs for TEST_DURATION milliseconds. TCP RX ends TCP_IDLE_TIMEOUT
+ after the last data if the client disappears without closing the connection.
+ The echo server must return the probe unchanged, its first 4 bytes are the
+ sequence number of the probe. The tests are in BenchmarkCore.h, which the
+ host build in extras/host runs against a simulated ESP and peer.
+
+ Circuit:
+ * Board with an ESP32 WiFi module driven by ESPHost
+ */
+
+#include <ESPHostEMAC.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#include "arduino_secrets.h"
+#include "BenchmarkCore.h"
+///////please enter your sensitive data in the Secret tab/arduino_secrets.h
+char ssid[] = SECRET_SSID;        // your network SSID (name)
+char pass[] = SECRET_PASS;        // your network password
+
+IPAddress peer(192, 168, 1, 100); // address of the machine running iperf or the echo server
+
+int status = WL_IDLE_STATUS;
+WiFiServer server(IPERF_PORT);
+WiFiUDP udp;
+Benchmark<WiFiClient, WiFiServer, WiFiUDP> benchmark(server, udp, Serial, peer);
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial);
+
+  if (WiFi.status() == WL_NO_MODULE) {
+    Serial.println("Communication with WiFi module failed!");
+    while (true);
+  }
+
+  while (status != WL_CONNECTED) {
+    Serial.print("Attempting to connect to Network named: ");
+    Serial.println(ssid);
+    status = WiFi.begin(ssid, pass);
+    delay(3000);
+  }
+  server.begin();
+
+  Serial.print("IP Address: ");
+  Serial.println(WiFi.localIP());
+  benchmark.printHelp();
+}
+
+void loop() {
+  if (!Serial.available()) {
+    return;
+  }
+  char c = Serial.read();
+  if (c == '\r' || c == '\n') {
+    return;
+  }
+  benchmark.run(c);
+}
@@ -0,0 +1,113 @@
+// Test frames of the host build
+
+#ifndef HOST_FRAME_H_
+#define HOST_FRAME_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define HOST_FRAME_ETH_IPV4   0x0800
+#define HOST_FRAME_HEADER     14
+#define HOST_FRAME_STAMP      16    // magic, sequence number and creation time after the Ethernet header
+#define HOST_FRAME_MIN        (HOST_FRAME_HEADER + HOST_FRAME_STAMP)
+#define HOST_FRAME_MAX        1514
+
+#define HOST_LATENCY_BUCKETS  10000 // of 100 us
+
+/** HostFrame
+ *  Ethernet frame with a sequence number and the time it was created,
+ *  so the receiver can check the order and measure the latency.
+ */
+struct HostFrame {
+
+  static void build(uint8_t *data, uint16_t len, uint16_t ethertype, uint32_t seq, uint64_t time) {
+    memset(data, 0, len);
+    static const uint8_t dst[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+    static const uint8_t src[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+    memcpy(data, dst, 6);
+    memcpy(data + 6, src, 6);
+    data[12] = ethertype >> 8;
+    data[13] = ethertype;
+    if (len < HOST_FRAME_MIN)
+      return;
+    memcpy(data + HOST_FRAME_HEADER, "ESPH", 4);
+    memcpy(data + HOST_FRAME_HEADER + 4, &seq, 4);
+    memcpy(data + HOST_FRAME_HEADER + 8, &time, 8);
+    for (uint16_t i = HOST_FRAME_MIN; i < len; i++) {
+      data[i] = (uint8_t) (seq + i);
+    }
+  }
+
+  static uint16_t ethertype(const uint8_t *data) {
+    return (data[12] << 8) | data[13];
+  }
+
+  static bool parse(const uint8_t *data, uint16_t len, uint32_t &seq, uint64_t &time) {
+    if (len < HOST_FRAME_MIN || memcmp(data + HOST_FRAME_HEADER, "ESPH", 4) != 0)
+      return false;
+    memcpy(&seq, data + HOST_FRAME_HEADER + 4, 4);
+    memcpy(&time, data + HOST_FRAME_HEADER + 8, 8);
+    return true;
+  }
+
+  /** Check the payload written by build */
+  static bool verify(const uint8_t *data, uint16_t len) {
+    uint32_t seq;
+    uint64_t time;
+    if (!parse(data, len, seq, time))
+      return false;
+    for (uint16_t i = HOST_FRAME_MIN; i < len; i++) {
+      if (data[i] != (uint8_t) (seq + i))
+        return false;
+    }
+    return true;
+  }
+};
+
+/** Latency statistics in microseconds */
+struct HostLatency {
+  uint32_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+  uint32_t histogram[HOST_LATENCY_BUCKETS];
+
+  HostLatency() {
+    clear();
+  }
+
+  void clear() {
+    memset(this, 0, sizeof(*this));
+  }
+
+  void add(uint64_t us) {
+    if (count == 0 || us < min) {
+      min = us;
+    }
+    if (us > max) {
+      max = us;
+    }
+    count++;
+    sum += us;
+    uint64_t bucket = us / 100;
+    histogram[(bucket < HOST_LATENCY_BUCKETS) ? bucket : HOST_LATENCY_BUCKETS - 1]++;
+  }
+
+  uint64_t avg() const {
+    return count ? sum / count : 0;
+  }
+
+  /** Upper bound of the percentile with 100 us resolution */
+  uint64_t percentile(unsigned p) const {
+    uint32_t target = ((uint64_t) count * p + 99) / 100;
+    uint32_t n = 0;
+    for (unsigned i = 0; i < HOST_LATENCY_BUCKETS; i++) {
+      n += histogram[i];
+      if (n >= target && n)
+        return ((i + 1) * 100 < max) ? (i + 1) * 100 : max;
+    }
+    return max;
+  }
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include "HostMemoryManager.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+HostMemoryManager::HostMemoryManager(uint32_t heap_size, uint32_t pool_count) :
+    heap_used(0), heap_peak(0), heap_allocs(0), heap_failures(0),
+    pool_used(0), pool_allocs(0), pool_failures(0),
+    heapSize(heap_size), maxBlock(UINT32_MAX), poolCount(pool_count) {
+  memset(bufs, 0, sizeof(bufs));
+  memset(unitUsed, 0, sizeof(unitUsed));
+  if (poolCount > HOST_MEM_POOL_MAX) {
+    poolCount = HOST_MEM_POOL_MAX;
+  }
+}
+
+void HostMemoryManager::set_heap(uint32_t heap_size, uint32_t max_block) {
+  heapSize = heap_size;
+  maxBlock = max_block;
+}
+
+void HostMemoryManager::set_pool(uint32_t pool_count) {
+  poolCount = (pool_count > HOST_MEM_POOL_MAX) ? HOST_MEM_POOL_MAX : pool_count;
+}
+
+HostMemoryManager::Buf* HostMemoryManager::takeBuf() {
+  for (unsigned i = 0; i < HOST_MEM_BUFS; i++) {
+    if (!bufs[i].used) {
+      memset(&bufs[i], 0, sizeof(Buf));
+      bufs[i].used = true;
+      bufs[i].unit = -1;
+      return &bufs[i];
+    }
+  }
+  return NULL;
+}
+
+void HostMemoryManager::releaseBuf(Buf *b) {
+  if (b->unit >= 0) {
+    unitUsed[b->unit] = false;
+    pool_used--;
+  } else {
+    heap_used -= b->size;
+    ::free(b->mem);
+  }
+  b->used = false;
+}
+
+emac_mem_buf_t* HostMemoryManager::alloc_heap(uint32_t size, uint32_t align) {
+  if (heap_used + size > heapSize || size > maxBlock) {
+    heap_failures++;
+    return NULL;
+  }
+  Buf *b = takeBuf();
+  if (b == NULL) {
+    heap_failures++;
+    return NULL;
+  }
+  // malloc, not new: the lwIP heap is not the C++ heap counted by HostSim
+  b->mem = (uint8_t*) malloc(size + align);
+  b->ptr = b->mem;
+  if (align && reinterpret_cast<uintptr_t>(b->ptr) % align) {
+    b->ptr += align - reinterpret_cast<uintptr_t>(b->ptr) % align;
+  }
+  b->len = size;
+  b->size = size;
+  heap_used += size;
+  heap_allocs++;
+  if (heap_used > heap_peak) {
+    heap_peak = heap_used;
+  }
+  return b;
+}
+
+emac_mem_buf_t* HostMemoryManager::alloc_pool(uint32_t size, uint32_t align) {
+  (void) align; // the arena units are aligned
+  uint32_t units = (size + HOST_MEM_POOL_UNIT - 1) / HOST_MEM_POOL_UNIT;
+  if (units == 0) {
+    units = 1;
+  }
+  if (pool_used + units > poolCount) {
+    pool_failures++;
+    return NULL;
+  }
+  Buf *head = NULL;
+  Buf *tail = NULL;
+  uint32_t left = size;
+  for (unsigned u = 0; u < poolCount && units; u++) {
+    if (unitUsed[u])
+      continue;
+    Buf *b = takeBuf();
+    if (b == NULL) {
+      if (head) {
+        free(head);
+      }
+      pool_failures++;
+      return NULL;
+    }
+    unitUsed[u] = true;
+    pool_used++;
+    b->unit = u;
+    b->ptr = arena[u];
+    b->len = (left < HOST_MEM_POOL_UNIT) ? left : HOST_MEM_POOL_UNIT;
+    left -= b->len;
+    if (tail) {
+      tail->next = b;
+    } else {
+      head = b;
+    }
+    tail = b;
+    units--;
+  }
+  pool_allocs++;
+  return head;
+}
+
+uint32_t HostMemoryManager::get_pool_alloc_unit(uint32_t align) const {
+  (void) align;
+  return HOST_MEM_POOL_UNIT;
+}
+
+emac_mem_buf_t* HostMemoryManager::alloc_frame(uint32_t size, bool unaligned, bool chained) {
+  if (chained) {
+    uint32_t first = size / 2;
+    Buf *a = (Buf*) alloc_heap(first, 4);
+    Buf *b = (Buf*) alloc_heap(size - first, 4);
+    if (a == NULL || b == NULL) {
+      if (a) {
+        free(a);
+      }
+      if (b) {
+        free(b);
+      }
+      return NULL;
+    }
+    a->next = b;
+    return a;
+  }
+  Buf *b = (Buf*) alloc_heap(size + 1, 4);
+  if (b == NULL)
+    return NULL;
+  if (unaligned) {
+    b->ptr++;
+  }
+  b->len = size;
+  return b;
+}
+
+void HostMemoryManager::free(emac_mem_buf_t *buf) {
+  Buf *b = (Buf*) buf;
+  while (b) {
+    Buf *next = b->next;
+    releaseBuf(b);
+    b = next;
+  }
+}
+
+uint32_t HostMemoryManager::get_total_len(const emac_mem_buf_t *buf) const {
+  uint32_t len = 0;
+  for (const Buf *b = (const Buf*) buf; b; b = b->next) {
+    len += b->len;
+  }
+  return len;
+}
+
+void HostMemoryManager::copy(emac_mem_buf_t *to_buf, const emac_mem_buf_t *from_buf) {
+  Buf *to = (Buf*) to_buf;
+  uint32_t offset = 0;
+  for (const Buf *from = (const Buf*) from_buf; from && to; from = from->next) {
+    uint32_t done = 0;
+    while (done < from->len && to) {
+      uint32_t n = from->len - done;
+      if (n > to->len - offset) {
+        n = to->len - offset;
+      }
+      memcpy(to->ptr + offset, from->ptr + done, n);
+      done += n;
+      offset += n;
+      if (offset == to->len) {
+        to = to->next;
+        offset = 0;
+      }
+    }
+  }
+}
+
+void HostMemoryManager::copy_to_buf(emac_mem_buf_t *to_buf, const void *ptr, uint32_t len) {
+  const uint8_t *src = (const uint8_t*) ptr;
+  for (Buf *b = (Buf*) to_buf; b && len; b = b->next) {
+    uint32_t n = (len < b->len) ? len : b->len;
+    memcpy(b->ptr, src, n);
+    src += n;
+    len -= n;
+  }
+}
+
+uint32_t HostMemoryManager::copy_from_buf(void *ptr, uint32_t len, const emac_mem_buf_t *from_buf) const {
+  uint8_t *dst = (uint8_t*) ptr;
+  uint32_t copied = 0;
+  for (const Buf *b = (const Buf*) from_buf; b && copied < len; b = b->next) {
+    uint32_t n = (len - copied < b->len) ? len - copied : b->len;
+    memcpy(dst + copied, b->ptr, n);
+    copied += n;
+  }
+  return copied;
+}
+
+void HostMemoryManager::cat(emac_mem_buf_t *to_buf, emac_mem_buf_t *cat_buf) {
+  Buf *b = (Buf*) to_buf;
+  while (b->next) {
+    b = b->next;
+  }
+  b->next = (Buf*) cat_buf;
+}
+
+emac_mem_buf_t* HostMemoryManager::get_next(const emac_mem_buf_t *buf) const {
+  return ((const Buf*) buf)->next;
+}
+
+void* HostMemoryManager::get_ptr(const emac_mem_buf_t *buf) const {
+  return ((const Buf*) buf)->ptr;
+}
+
+uint32_t HostMemoryManager::get_len(const emac_mem_buf_t *buf) const {
+  return ((const Buf*) buf)->len;
+}
+
+void HostMemoryManager::set_len(emac_mem_buf_t *buf, uint32_t len) {
+  ((Buf*) buf)->len = len;
+}
@@ -0,0 +1,82 @@
+// Memory manager of the host build, a model of the lwIP heap and pbuf pool
+
+#ifndef HOST_MEMORY_MANAGER_H_
+#define HOST_MEMORY_MANAGER_H_
+
+#include <stdint.h>
+#include "EMAC.h"
+
+#define HOST_MEM_BUFS       512   // buffer descriptors
+#define HOST_MEM_POOL_UNIT  512   // bytes of a pool buffer
+#define HOST_MEM_POOL_MAX   64    // pool buffers
+
+/** HostMemoryManager
+ *  EMACMemoryManager with a heap of limited size and a pool of fixed size buffers.
+ *
+ *  The heap can be limited to a largest allocation to model a fragmented heap.
+ *  The pool buffers are in a static arena and a pool allocation larger than
+ *  one unit is a chain, like pbufs of the lwIP pool.
+ */
+class HostMemoryManager : public EMACMemoryManager {
+public:
+
+  HostMemoryManager(uint32_t heap_size = 64 * 1024, uint32_t pool_count = 32);
+
+  /** Set the heap limits
+   *
+   * @param heap_size  bytes of heap for frames
+   * @param max_block  largest heap allocation, the rest is fragmented
+   */
+  void set_heap(uint32_t heap_size, uint32_t max_block = UINT32_MAX);
+
+  /** Set the count of pool buffers, up to HOST_MEM_POOL_MAX */
+  void set_pool(uint32_t pool_count);
+
+  /** Allocate a frame of the stack to send, unaligned or chained to exercise the EMAC copy */
+  emac_mem_buf_t* alloc_frame(uint32_t size, bool unaligned = false, bool chained = false);
+
+  virtual emac_mem_buf_t* alloc_heap(uint32_t size, uint32_t align);
+  virtual emac_mem_buf_t* alloc_pool(uint32_t size, uint32_t align);
+  virtual uint32_t get_pool_alloc_unit(uint32_t align) const;
+  virtual void free(emac_mem_buf_t *buf);
+  virtual uint32_t get_total_len(const emac_mem_buf_t *buf) const;
+  virtual void copy(emac_mem_buf_t *to_buf, const emac_mem_buf_t *from_buf);
+  virtual void copy_to_buf(emac_mem_buf_t *to_buf, const void *ptr, uint32_t len);
+  virtual uint32_t copy_from_buf(void *ptr, uint32_t len, const emac_mem_buf_t *from_buf) const;
+  virtual void cat(emac_mem_buf_t *to_buf, emac_mem_buf_t *cat_buf);
+  virtual emac_mem_buf_t* get_next(const emac_mem_buf_t *buf) const;
+  virtual void* get_ptr(const emac_mem_buf_t *buf) const;
+  virtual uint32_t get_len(const emac_mem_buf_t *buf) const;
+  virtual void set_len(emac_mem_buf_t *buf, uint32_t len);
+
+  uint32_t heap_used;
+  uint32_t heap_peak;
+  uint32_t heap_allocs;
+  uint32_t heap_failures;
+  uint32_t pool_used;
+  uint32_t pool_allocs;
+  uint32_t pool_failures;
+
+private:
+  struct Buf {
+    Buf *next;
+    uint8_t *mem;   // heap memory, NULL for a pool buffer
+    uint8_t *ptr;
+    uint32_t len;
+    uint32_t size;  // heap bytes accounted
+    int16_t unit;   // pool unit, -1 for heap
+    bool used;
+  };
+
+  Buf* takeBuf();
+  void releaseBuf(Buf *b);
+
+  Buf bufs[HOST_MEM_BUFS];
+  uint32_t heapSize;
+  uint32_t maxBlock;
+  uint32_t poolCount;
+  bool unitUsed[HOST_MEM_POOL_MAX];
+  alignas(8) uint8_t arena[HOST_MEM_POOL_MAX][HOST_MEM_POOL_UNIT];
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include "HostSim.h"
+
+#include <stdlib.h>
+#include <new>
+
+#define HOST_SIM_QUEUE_SIZE 64
+
+struct QueuedEvent {
+  int id;
+  uint64_t due;
+  bool worker;
+  HostSim::Event event;
+};
+
+// a fixed array, so queueing an event doesn't allocate and disturb the heap counts
+static QueuedEvent queue[HOST_SIM_QUEUE_SIZE];
+static unsigned queued = 0;
+static int lastId = 0;
+static uint64_t now = 0;
+static uint32_t heapAllocs = 0;
+static bool inWorker = false;
+
+unsigned HostSim::lock_depth = 0;
+uint32_t HostSim::blocked_with_lock = 0;
+uint64_t HostSim::max_blocked_with_lock_us = 0;
+uint32_t HostSim::worker_blocked_with_lock = 0;
+mbed::Callback<void(int pin, int value)> HostSim::digital_write;
+mbed::Callback<void()> HostSim::data_ready;
+uint64_t HostSim::data_ready_period_us = 0;
+
+uint64_t HostSim::now_us() {
+  return now;
+}
+
+int HostSim::call_in_us(uint64_t delay_us, Event event) {
+  if (queued == HOST_SIM_QUEUE_SIZE)
+    abort(); // an event chain multiplies
+  QueuedEvent &e = queue[queued++];
+  e.id = ++lastId;
+  e.due = now + delay_us;
+  e.worker = false;
+  e.event = event;
+  return e.id;
+}
+
+int HostSim::call_worker(Event event) {
+  int id = call_in_us(0, event);
+  queue[queued - 1].worker = true;
+  return id;
+}
+
+bool HostSim::cancel(int id) {
+  for (unsigned i = 0; i < queued; i++) {
+    if (queue[i].id == id) {
+      queue[i] = queue[--queued];
+      return true;
+    }
+  }
+  return false;
+}
+
+// the earliest event, events due at the same time in the order they were queued
+static int nextEvent(uint64_t end) {
+  int next = -1;
+  for (unsigned i = 0; i < queued; i++) {
+    if (queue[i].due > end)
+      continue;
+    if (next < 0 || queue[i].due < queue[next].due || (queue[i].due == queue[next].due && queue[i].id < queue[next].id)) {
+      next = i;
+    }
+  }
+  return next;
+}
+
+void HostSim::run_for(uint64_t us) {
+  uint64_t end = now + us;
+  int i;
+  while ((i = nextEvent(end)) >= 0) {
+    QueuedEvent e = queue[i];
+    queue[i] = queue[--queued];
+    if (e.due > now) {
+      now = e.due;
+    }
+    bool wasInWorker = inWorker;
+    inWorker = e.worker;
+    e.event();
+    inWorker = wasInWorker;
+  }
+  if (now < end) {
+    now = end;
+  }
+}
+
+bool HostSim::run_until(mbed::Callback<bool()> condition, uint64_t timeout_us) {
+  uint64_t end = now + timeout_us;
+  while (!condition() && now < end) {
+    int i = nextEvent(end);
+    if (i < 0) {
+      now = end;
+      break;
+    }
+    run_for((queue[i].due > now) ? queue[i].due - now : 0);
+  }
+  return condition();
+}
+
+void HostSim::busy(uint64_t us) {
+  if (lock_depth) {
+    now += us;
+  } else {
+    run_for(us);
+  }
+}
+
+void HostSim::sleep(uint64_t us) {
+  if (lock_depth && inWorker) {
+    worker_blocked_with_lock++;
+  } else if (lock_depth) {
+    blocked_with_lock++;
+    if (us > max_blocked_with_lock_us) {
+      max_blocked_with_lock_us = us;
+    }
+  }
+  busy(us);
+}
+
+unsigned HostSim::pending() {
+  return queued;
+}
+
+uint32_t HostSim::heap_allocs() {
+  return heapAllocs;
+}
+
+void* operator new(size_t size) {
+  heapAllocs++;
+  void *p = malloc(size ? size : 1);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  heapAllocs++;
+  return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+  free(p);
+}
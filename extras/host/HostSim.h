@@ -0,0 +1,137 @@
+// Virtual time and the event queue of the host build
+
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+#include <stdint.h>
+#include <chrono>
+#include "platform/Callback.h"
+
+/** HostSim
+ *  Single threaded simulation of the MCU. The event queue of the receive task,
+ *  the worker and the test's own events run in virtual time. A blocking wait
+ *  (delay, a control request) dispatches the events due meanwhile, like the
+ *  other threads would run on the MCU, except while a mutex is held. Then they
+ *  are delayed, like they would wait for the mutex. The waits with a mutex held
+ *  are counted, those of the worker thread separately: the EMAC stops its
+ *  datapath while the worker holds the mutex.
+ */
+class HostSim {
+public:
+  typedef mbed::Callback<void()> Event;
+
+  /** Return the virtual time in microseconds */
+  static uint64_t now_us();
+
+  /** Queue an event to run after delay_us, returns the event id */
+  static int call_in_us(uint64_t delay_us, Event event);
+
+  /** Queue an event of the worker thread, returns the event id */
+  static int call_worker(Event event);
+
+  /** Cancel a queued event, returns false if it is running or done */
+  static bool cancel(int id);
+
+  /** Run the events due in the next us microseconds */
+  static void run_for(uint64_t us);
+
+  /** Run events until the condition is true or timeout_us elapsed, returns the condition */
+  static bool run_until(mbed::Callback<bool()> condition, uint64_t timeout_us);
+
+  /** The running code computes or transfers for us microseconds */
+  static void busy(uint64_t us);
+
+  /** The running code waits for us microseconds (delay, sleep) */
+  static void sleep(uint64_t us);
+
+  /** Return the count of queued events */
+  static unsigned pending();
+
+  /** Return the count of heap allocations (operator new) */
+  static uint32_t heap_allocs();
+
+  /** Count of mutexes held by the running code */
+  static unsigned lock_depth;
+
+  /** Count of waits with a mutex held, outside of the worker thread */
+  static uint32_t blocked_with_lock;
+
+  /** Longest wait with a mutex held outside of the worker thread in microseconds */
+  static uint64_t max_blocked_with_lock_us;
+
+  /** Count of waits with a mutex held in the worker thread */
+  static uint32_t worker_blocked_with_lock;
+
+  /** Called for digitalWrite */
+  static mbed::Callback<void(int pin, int value)> digital_write;
+
+  /** Called by SimEsp when the data-ready line of the ESP is seen high */
+  static mbed::Callback<void()> data_ready;
+
+  /** Sampling period of the data-ready line, the line is seen at the next sample */
+  static uint64_t data_ready_period_us;
+};
+
+/** Mutex of the host build. The simulation has one thread, so it only counts. */
+class HostMutex {
+public:
+  void lock() {
+    HostSim::lock_depth++;
+  }
+  void unlock() {
+    HostSim::lock_depth--;
+  }
+  bool trylock() {
+    lock();
+    return true;
+  }
+};
+
+/** Clock of the host build, millisecond ticks in virtual time like rtos::Kernel::Clock */
+struct HostClock {
+  typedef std::chrono::milliseconds duration;
+  typedef duration::rep rep;
+  typedef duration::period period;
+  typedef std::chrono::time_point<HostClock> time_point;
+  static constexpr bool is_steady = true;
+
+  static time_point now() {
+    return time_point(duration(HostSim::now_us() / 1000));
+  }
+};
+
+/** Platform of ESPHostEMACBase on the host, see ESPHostMbedPlatform */
+struct HostPlatform {
+
+  typedef HostMutex Mutex;
+  typedef HostClock Clock;
+
+  static int call(mbed::Callback<void()> func) {
+    return HostSim::call_in_us(0, func);
+  }
+
+  static int call_in(std::chrono::milliseconds delay, mbed::Callback<void()> func) {
+    return HostSim::call_in_us(delay.count() * 1000, func);
+  }
+
+  static bool cancel(int id) {
+    return HostSim::cancel(id);
+  }
+
+  static int call_worker(mbed::Callback<void()> func, unsigned char *stack, uint32_t stack_size) {
+    (void) stack;
+    (void) stack_size;
+    return HostSim::call_worker(func);
+  }
+
+  static void attach_data_ready(mbed::Callback<void()> func, std::chrono::milliseconds period) {
+    HostSim::data_ready = func;
+    HostSim::data_ready_period_us = period.count() * 1000;
+  }
+
+  static size_t ram_footprint() {
+    return 0; // the simulator isn't part of the driver
+  }
+};
+
+#endif
@@ -0,0 +1,342 @@
+#include "HostSocket.h"
+#include "SimEsp.h"
+
+#define HOST_SOCKET_PROTO    HOST_FRAME_HEADER
+#define HOST_SOCKET_FLAGS    (HOST_FRAME_HEADER + 1)
+#define HOST_SOCKET_PORT     (HOST_FRAME_HEADER + 2)
+#define HOST_SOCKET_POLL_US  200   // the peer checks for room in the ESP
+#define HOST_SOCKET_IFACE    0     // the peer is behind the station
+
+static uint16_t headerSize(uint8_t proto) {
+  return (proto == HOST_SOCKET_TCP) ? HOST_SOCKET_TCP_HEADER : HOST_SOCKET_UDP_HEADER;
+}
+
+// builds the frame of a packet, returns its length
+static uint16_t buildFrame(uint8_t *frame, uint8_t proto, uint8_t flags, uint16_t port, const uint8_t *data, uint16_t len) {
+  uint16_t header = headerSize(proto);
+  HostFrame::build(frame, header, HOST_FRAME_ETH_IPV4, 0, 0);
+  frame[HOST_SOCKET_PROTO] = proto;
+  frame[HOST_SOCKET_FLAGS] = flags;
+  frame[HOST_SOCKET_PORT] = port >> 8;
+  frame[HOST_SOCKET_PORT + 1] = port;
+  if (len > HOST_FRAME_MAX - header) {
+    len = HOST_FRAME_MAX - header;
+  }
+  if (data) {
+    memcpy(frame + header, data, len);
+  } else {
+    memset(frame + header, 0, len);
+  }
+  return header + len;
+}
+
+// parses the frame of a packet into p, returns the protocol, 0 if it isn't a packet
+static uint8_t parseFrame(const uint8_t *frame, uint16_t len, HostNet::Packet &p) {
+  if (len < HOST_SOCKET_UDP_HEADER || HostFrame::ethertype(frame) != HOST_FRAME_ETH_IPV4)
+    return 0;
+  uint8_t proto = frame[HOST_SOCKET_PROTO];
+  if (proto != HOST_SOCKET_TCP && proto != HOST_SOCKET_UDP)
+    return 0;
+  uint16_t header = headerSize(proto);
+  if (len < header)
+    return 0;
+  p.flags = frame[HOST_SOCKET_FLAGS];
+  p.port = (frame[HOST_SOCKET_PORT] << 8) | frame[HOST_SOCKET_PORT + 1];
+  p.len = len - header;
+  p.offset = 0;
+  memcpy(p.data, frame + header, p.len);
+  return proto;
+}
+
+HostNet& HostNet::instance() {
+  static HostNet net;
+  return net;
+}
+
+HostNet::HostNet() :
+    tcp_listen(true), tcp_bytes(0), udp_datagrams(0), udp_bytes(0), udp_lost(0), udp_out_of_order(0), udp_fins(0), echoes(0),
+    udp_port(0), tcp_open(false), tcp_fin(false), rx_drops(0), stack(NULL),
+    tcpStreamLeft(0), tcpStreamClose(false), udpStreamPort(0), udpStreamLen(0), udpStreamLeft(0), udpNextSeq(0), echoCount(0) {
+  params.udp_interval_us = 600; // 20 Mbit/s of full size datagrams
+  params.echo_port = 7;
+  params.echo_delay_us = 2000;
+  params.late_echo = 0;
+  params.late_echo_us = 0;
+  tcp_rx.clear();
+  udp_rx.clear();
+}
+
+void HostNet::attach(HostStack &stack) {
+  this->stack = &stack;
+  stack.on_frame = mbed::callback(this, &HostNet::input);
+  SimEsp::instance().air_tx = mbed::callback(this, &HostNet::peerInput);
+}
+
+bool HostNet::send(uint8_t proto, uint8_t flags, uint16_t port, const uint8_t *data, uint16_t len) {
+  uint16_t size = buildFrame(frame, proto, flags, port, data, len);
+  return stack->send_frame(frame, size);
+}
+
+// a frame delivered to the stack by the EMAC
+void HostNet::input(const uint8_t *frame, uint16_t len) {
+  static Packet p;
+  uint8_t proto = parseFrame(frame, len, p);
+  Queue *q = NULL;
+  if (proto == HOST_SOCKET_UDP && p.port == udp_port && udp_port) {
+    q = &udp_rx;
+  } else if (proto == HOST_SOCKET_TCP) {
+    if (p.flags & HOST_SOCKET_FIN) {
+      tcp_fin = true;
+    }
+    if (p.len || (p.flags & HOST_SOCKET_SYN)) {
+      q = &tcp_rx;
+    }
+  }
+  if (q == NULL || q->count == HOST_SOCKET_QUEUE) {
+    if (proto && !(p.flags & HOST_SOCKET_FIN)) {
+      rx_drops++;
+    }
+    return;
+  }
+  q->packets[(q->head + q->count) % HOST_SOCKET_QUEUE] = p;
+  q->count++;
+}
+
+// a frame the ESP sent to the air
+void HostNet::peerInput(int iface, const uint8_t *frame, uint16_t len) {
+  (void) iface;
+  static Packet p;
+  uint8_t proto = parseFrame(frame, len, p);
+  if (proto == HOST_SOCKET_TCP) {
+    tcp_bytes += p.len;
+  } else if (proto == HOST_SOCKET_UDP && p.port == params.echo_port) {
+    echoes++;
+    if (echoCount == HOST_SOCKET_QUEUE)
+      return;
+    uint64_t delay = (echoes == params.late_echo) ? params.late_echo_us : params.echo_delay_us;
+    echo[echoCount] = p;
+    echoDueUs[echoCount] = HostSim::now_us() + delay;
+    echoCount++;
+    HostSim::call_in_us(delay, mbed::callback(this, &HostNet::echoDue));
+  } else if (proto == HOST_SOCKET_UDP) {
+    iperfInput(p);
+  }
+}
+
+// the UDP iperf server, the datagrams start with the iperf2 header
+void HostNet::iperfInput(const Packet &p) {
+  int32_t seq = -1;
+  if (p.len >= 12) {
+    seq = (int32_t) (((uint32_t) p.data[0] << 24) | (p.data[1] << 16) | (p.data[2] << 8) | p.data[3]);
+  }
+  if (seq < 0) { // the end of the test, the report goes back to the client
+    udp_fins++;
+    udpNextSeq = 0;
+    peerSend(HOST_SOCKET_UDP, 0, p.port, p.data, p.len);
+    return;
+  }
+  udp_datagrams++;
+  udp_bytes += p.len;
+  if ((uint32_t) seq > udpNextSeq) {
+    udp_lost += seq - udpNextSeq;
+  } else if ((uint32_t) seq < udpNextSeq) {
+    udp_out_of_order++;
+    return;
+  }
+  udpNextSeq = seq + 1;
+}
+
+void HostNet::echoDue() {
+  unsigned next = 0;
+  for (unsigned i = 1; i < echoCount; i++) {
+    if (echoDueUs[i] < echoDueUs[next]) {
+      next = i;
+    }
+  }
+  peerSend(HOST_SOCKET_UDP, 0, echo[next].port, echo[next].data, echo[next].len);
+  echoCount--;
+  echo[next] = echo[echoCount];
+  echoDueUs[next] = echoDueUs[echoCount];
+}
+
+bool HostNet::peerSend(uint8_t proto, uint8_t flags, uint16_t port, const uint8_t *data, uint16_t len) {
+  static uint8_t peerFrame[HOST_FRAME_MAX];
+  uint16_t size = buildFrame(peerFrame, proto, flags, port, data, len);
+  return SimEsp::instance().air_rx(HOST_SOCKET_IFACE, peerFrame, size);
+}
+
+void HostNet::start_tcp_stream(uint32_t bytes, bool close) {
+  tcpStreamLeft = bytes;
+  tcpStreamClose = close;
+  peerSend(HOST_SOCKET_TCP, HOST_SOCKET_SYN, 0, NULL, 0);
+  HostSim::call_in_us(HOST_SOCKET_POLL_US, mbed::callback(this, &HostNet::tcpStreamNext));
+}
+
+// the next segment when the ESP has room, like a sender limited by the TCP window
+void HostNet::tcpStreamNext() {
+  SimEsp &esp = SimEsp::instance();
+  if (esp.esp_rx_queued(HOST_SOCKET_IFACE) < esp.params.esp_rx_frames) {
+    if (tcpStreamLeft == 0) {
+      if (tcpStreamClose) {
+        peerSend(HOST_SOCKET_TCP, HOST_SOCKET_FIN, 0, NULL, 0);
+      }
+      return;
+    }
+    uint16_t len = (tcpStreamLeft < HOST_FRAME_MAX - HOST_SOCKET_TCP_HEADER) ? tcpStreamLeft : HOST_FRAME_MAX - HOST_SOCKET_TCP_HEADER;
+    peerSend(HOST_SOCKET_TCP, 0, 0, NULL, len);
+    tcpStreamLeft -= len;
+  }
+  HostSim::call_in_us(HOST_SOCKET_POLL_US, mbed::callback(this, &HostNet::tcpStreamNext));
+}
+
+void HostNet::start_udp_stream(uint16_t port, uint16_t len, uint32_t datagrams) {
+  udpStreamPort = port;
+  udpStreamLen = len;
+  udpStreamLeft = datagrams;
+  udpStreamNext();
+}
+
+void HostNet::udpStreamNext() {
+  if (udpStreamLeft == 0)
+    return;
+  udpStreamLeft--;
+  peerSend(HOST_SOCKET_UDP, 0, udpStreamPort, NULL, udpStreamLen);
+  HostSim::call_in_us(params.udp_interval_us, mbed::callback(this, &HostNet::udpStreamNext));
+}
+
+int HostTcpClient::connect(IPAddress ip, uint16_t port) {
+  (void) ip;
+  HostNet &net = HostNet::instance();
+  HostNet::call();
+  if (!net.tcp_listen)
+    return 0;
+  net.tcp_rx.clear();
+  net.tcp_open = true;
+  net.tcp_fin = false;
+  open = true;
+  this->port = port;
+  return 1;
+}
+
+uint8_t HostTcpClient::connected() {
+  HostNet::call();
+  return open && !HostNet::instance().tcp_fin;
+}
+
+int HostTcpClient::available() {
+  HostNet::call();
+  HostNet::Packet *p = HostNet::instance().tcp_rx.front();
+  return (open && p) ? p->len - p->offset : 0;
+}
+
+size_t HostTcpClient::write(const uint8_t *buf, size_t size) {
+  HostNet::call();
+  if (!open)
+    return 0;
+  if (size > HOST_FRAME_MAX - HOST_SOCKET_TCP_HEADER) {
+    size = HOST_FRAME_MAX - HOST_SOCKET_TCP_HEADER;
+  }
+  return HostNet::instance().send(HOST_SOCKET_TCP, 0, port, buf, size) ? size : 0;
+}
+
+int HostTcpClient::read(uint8_t *buf, size_t size) {
+  HostNet::call();
+  HostNet &net = HostNet::instance();
+  HostNet::Packet *p = net.tcp_rx.front();
+  if (!open || p == NULL)
+    return -1;
+  size_t n = p->len - p->offset;
+  if (n > size) {
+    n = size;
+  }
+  memcpy(buf, p->data + p->offset, n);
+  p->offset += n;
+  if (p->offset == p->len) {
+    net.tcp_rx.pop();
+  }
+  return n;
+}
+
+void HostTcpClient::stop() {
+  HostNet &net = HostNet::instance();
+  if (open) {
+    net.tcp_open = false;
+    net.tcp_rx.clear();
+  }
+  open = false;
+}
+
+HostTcpClient HostTcpServer::accept() {
+  HostNet::call();
+  HostNet &net = HostNet::instance();
+  HostTcpClient client;
+  HostNet::Packet *p = net.tcp_rx.front();
+  if (p && (p->flags & HOST_SOCKET_SYN)) {
+    net.tcp_rx.pop();
+    net.tcp_open = true;
+    net.tcp_fin = false;
+    client.open = true;
+    client.port = port;
+  }
+  return client;
+}
+
+uint8_t HostUdp::begin(uint16_t port) {
+  HostNet &net = HostNet::instance();
+  net.udp_port = port;
+  net.udp_rx.clear();
+  rxLen = 0;
+  rxOffset = 0;
+  return 1;
+}
+
+void HostUdp::stop() {
+  HostNet::instance().udp_port = 0;
+}
+
+int HostUdp::beginPacket(IPAddress ip, uint16_t port) {
+  (void) ip;
+  txPort = port;
+  txLen = 0;
+  return 1;
+}
+
+size_t HostUdp::write(const uint8_t *buf, size_t size) {
+  if (size > sizeof(txData) - txLen) {
+    size = sizeof(txData) - txLen;
+  }
+  memcpy(txData + txLen, buf, size);
+  txLen += size;
+  return size;
+}
+
+int HostUdp::endPacket() {
+  HostNet::call();
+  return HostNet::instance().send(HOST_SOCKET_UDP, 0, txPort, txData, txLen) ? 1 : 0;
+}
+
+// like WiFiUDP, the rest of the previous datagram is discarded
+int HostUdp::parsePacket() {
+  HostNet::call();
+  HostNet &net = HostNet::instance();
+  HostNet::Packet *p = net.udp_rx.front();
+  if (p == NULL) {
+    rxLen = 0;
+    return 0;
+  }
+  rxLen = p->len;
+  rxOffset = 0;
+  memcpy(rxData, p->data, p->len);
+  net.udp_rx.pop();
+  return rxLen;
+}
+
+int HostUdp::read(uint8_t *buf, size_t size) {
+  size_t n = rxLen - rxOffset;
+  if (n > size) {
+    n = size;
+  }
+  memcpy(buf, rxData + rxOffset, n);
+  rxOffset += n;
+  return n;
+}
@@ -0,0 +1,184 @@
+// Sockets of the host build for the benchmark core, and the peer they talk to
+
+#ifndef HOST_SOCKET_H_
+#define HOST_SOCKET_H_
+
+#include <stdint.h>
+#include "Arduino.h"
+#include "HostStack.h"
+
+#define HOST_SOCKET_TCP          6
+#define HOST_SOCKET_UDP          17
+#define HOST_SOCKET_SYN          0x01
+#define HOST_SOCKET_FIN          0x02
+#define HOST_SOCKET_TCP_HEADER   54    // Ethernet, IPv4 and TCP header
+#define HOST_SOCKET_UDP_HEADER   42    // Ethernet, IPv4 and UDP header
+#define HOST_SOCKET_PAYLOAD_MAX  (HOST_FRAME_MAX - HOST_SOCKET_UDP_HEADER)
+#define HOST_SOCKET_QUEUE        16    // received packets a socket keeps, more are dropped
+#define HOST_SOCKET_CALL_US      50    // virtual time of a socket call
+
+/** HostNet
+ *  The network between the host sockets and a peer behind the simulated ESP.
+ *  Segments and datagrams are frames with the protocol, the flags and the port
+ *  in the place of the IPv4 header, the headers have their real size.
+ *
+ *  The peer is an iperf server and client and an echo server. The UDP iperf
+ *  server checks the sequence numbers of the iperf2 header and answers the
+ *  final datagram with a report. There is no TCP
+ *  flow control or retransmission: the peer sends a TCP stream as fast as the
+ *  ESP has room, the sockets receive what the EMAC delivers. Every socket call
+ *  takes HOST_SOCKET_CALL_US of virtual time, in which the receive task and
+ *  the peer run.
+ */
+class HostNet {
+public:
+
+  struct Params {
+    uint32_t udp_interval_us;  // between the datagrams of the peer's UDP stream
+    uint16_t echo_port;        // of the echo server, UDP to other ports goes to the iperf server
+    uint32_t echo_delay_us;    // of the echo server
+    uint32_t late_echo;        // the reply to this echo probe (counted from 1) comes late, 0 for none
+    uint32_t late_echo_us;     // delay of the late reply
+  };
+
+  struct Packet {
+    uint8_t flags;
+    uint16_t port;
+    uint16_t len;
+    uint16_t offset;           // read by the socket
+    uint8_t data[HOST_SOCKET_PAYLOAD_MAX];
+  };
+
+  /** Packets received for a socket */
+  struct Queue {
+    Packet packets[HOST_SOCKET_QUEUE];
+    unsigned head;
+    unsigned count;
+
+    void clear() {
+      head = 0;
+      count = 0;
+    }
+    Packet* front() {
+      return count ? &packets[head] : NULL;
+    }
+    void pop() {
+      head = (head + 1) % HOST_SOCKET_QUEUE;
+      count--;
+    }
+  };
+
+  static HostNet& instance();
+
+  HostNet();
+
+  Params params;
+
+  /** Connect to the stack of the interface and to the air side of SimEsp */
+  void attach(HostStack &stack);
+
+  // the peer
+  bool tcp_listen;                   // accepts connections like iperf -s
+  uint32_t tcp_bytes;                // received by the peer
+  uint32_t udp_datagrams;
+  uint32_t udp_bytes;
+  uint32_t udp_lost;                 // gaps in the iperf sequence numbers
+  uint32_t udp_out_of_order;
+  uint32_t udp_fins;                 // final datagrams of iperf clients
+  uint32_t echoes;
+
+  /** The peer connects and sends bytes over TCP, then closes the connection
+   *  if close, else it disappears and leaves the connection half-open */
+  void start_tcp_stream(uint32_t bytes, bool close);
+
+  /** The peer sends datagrams of len bytes to port every params.udp_interval_us */
+  void start_udp_stream(uint16_t port, uint16_t len, uint32_t datagrams);
+
+  // the sockets
+  Queue tcp_rx;
+  Queue udp_rx;
+  uint16_t udp_port;                 // bound UDP socket, 0 for none
+  bool tcp_open;
+  bool tcp_fin;                      // the peer closed the connection
+  uint32_t rx_drops;                 // packets dropped for a full queue or no socket
+
+  /** Send a packet to the peer, returns false if the EMAC refused it */
+  bool send(uint8_t proto, uint8_t flags, uint16_t port, const uint8_t *data, uint16_t len);
+
+  /** A socket call, the other threads and the peer run meanwhile */
+  static void call() {
+    HostSim::sleep(HOST_SOCKET_CALL_US);
+  }
+
+private:
+  void input(const uint8_t *frame, uint16_t len);
+  void peerInput(int iface, const uint8_t *frame, uint16_t len);
+  void iperfInput(const Packet &p);
+  bool peerSend(uint8_t proto, uint8_t flags, uint16_t port, const uint8_t *data, uint16_t len);
+  void tcpStreamNext();
+  void udpStreamNext();
+  void echoDue();
+
+  HostStack *stack;
+  uint8_t frame[HOST_FRAME_MAX];
+  uint32_t tcpStreamLeft;
+  bool tcpStreamClose;
+  uint16_t udpStreamPort;
+  uint16_t udpStreamLen;
+  uint32_t udpStreamLeft;
+  uint32_t udpNextSeq;               // expected by the iperf server
+  Packet echo[HOST_SOCKET_QUEUE];    // replies of the echo server in the order they are due
+  uint64_t echoDueUs[HOST_SOCKET_QUEUE];
+  unsigned echoCount;
+};
+
+/** TCP client socket of the host build with the API of WiFiClient used by the benchmark */
+class HostTcpClient {
+public:
+  HostTcpClient() : open(false) {}
+  int connect(IPAddress ip, uint16_t port);
+  uint8_t connected();
+  int available();
+  size_t write(const uint8_t *buf, size_t size);
+  int read(uint8_t *buf, size_t size);
+  void stop();
+  explicit operator bool() const {
+    return open;
+  }
+private:
+  friend class HostTcpServer;
+  bool open;
+  uint16_t port;
+};
+
+/** TCP server socket of the host build with the API of WiFiServer used by the benchmark */
+class HostTcpServer {
+public:
+  explicit HostTcpServer(uint16_t port) : port(port) {}
+  void begin() {}
+  HostTcpClient accept();
+private:
+  uint16_t port;
+};
+
+/** UDP socket of the host build with the API of WiFiUDP used by the benchmark */
+class HostUdp {
+public:
+  HostUdp() : txPort(0), txLen(0), rxLen(0), rxOffset(0) {}
+  uint8_t begin(uint16_t port);
+  void stop();
+  int beginPacket(IPAddress ip, uint16_t port);
+  size_t write(const uint8_t *buf, size_t size);
+  int endPacket();
+  int parsePacket();
+  int read(uint8_t *buf, size_t size);
+private:
+  uint16_t txPort;
+  uint16_t txLen;
+  uint8_t txData[HOST_SOCKET_PAYLOAD_MAX];
+  uint16_t rxLen;
+  uint16_t rxOffset;
+  uint8_t rxData[HOST_SOCKET_PAYLOAD_MAX];
+};
+
+#endif
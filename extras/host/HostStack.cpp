@@ -0,0 +1,118 @@
+#include "HostStack.h"
+#include "HostSim.h"
+
+#include <stdlib.h>
+
+HostStack::HostStack(HostMemoryManager &memory) :
+    memory(memory), emac(NULL), proc_us(0), backlogHead(0), backlogCount(0), processing(false) {
+  clear();
+}
+
+void HostStack::clear() {
+  link_up = false;
+  link_changes = 0;
+  frames = 0;
+  bytes = 0;
+  bad_frames = 0;
+  out_of_order = 0;
+  backlog_peak = 0;
+  tx_nomem = 0;
+  tx_failed = 0;
+  last_seq = 0;
+  latency.clear();
+}
+
+void HostStack::attach(EMAC &emac) {
+  this->emac = &emac;
+  emac.set_memory_manager(memory);
+  emac.set_link_input_cb(mbed::callback(this, &HostStack::input));
+  emac.set_link_state_cb(mbed::callback(this, &HostStack::linkState));
+}
+
+bool HostStack::send(uint16_t len, uint32_t seq, uint16_t ethertype, bool unaligned, bool chained) {
+  emac_mem_buf_t *buf = memory.alloc_frame(len, unaligned, chained);
+  if (buf == NULL) {
+    tx_nomem++;
+    return false;
+  }
+  HostFrame::build(frame, len, ethertype, seq, HostSim::now_us());
+  memory.copy_to_buf(buf, frame, len);
+  if (!emac->link_out(buf)) {
+    tx_failed++;
+    return false;
+  }
+  return true;
+}
+
+bool HostStack::send_frame(const uint8_t *data, uint16_t len) {
+  emac_mem_buf_t *buf = memory.alloc_frame(len, false, false);
+  if (buf == NULL) {
+    tx_nomem++;
+    return false;
+  }
+  memory.copy_to_buf(buf, data, len);
+  if (!emac->link_out(buf)) {
+    tx_failed++;
+    return false;
+  }
+  return true;
+}
+
+void HostStack::linkState(bool up) {
+  if (up != link_up) {
+    link_changes++;
+  }
+  link_up = up;
+}
+
+void HostStack::input(emac_mem_buf_t *buf) {
+  if (proc_us == 0) {
+    process(buf);
+    return;
+  }
+  if (backlogCount == HOST_STACK_BACKLOG)
+    abort(); // the EMAC must stop on the memory limit before
+  backlog[(backlogHead + backlogCount) % HOST_STACK_BACKLOG] = buf;
+  backlogCount++;
+  if (backlogCount > backlog_peak) {
+    backlog_peak = backlogCount;
+  }
+  if (!processing) {
+    processing = true;
+    HostSim::call_in_us(proc_us, mbed::callback(this, &HostStack::processNext));
+  }
+}
+
+void HostStack::processNext() {
+  emac_mem_buf_t *buf = backlog[backlogHead];
+  backlogHead = (backlogHead + 1) % HOST_STACK_BACKLOG;
+  backlogCount--;
+  process(buf);
+  if (backlogCount) {
+    HostSim::call_in_us(proc_us, mbed::callback(this, &HostStack::processNext));
+  } else {
+    processing = false;
+  }
+}
+
+void HostStack::process(emac_mem_buf_t *buf) {
+  uint16_t len = memory.copy_from_buf(frame, sizeof(frame), buf);
+  memory.free(buf);
+  frames++;
+  bytes += len;
+  uint32_t seq;
+  uint64_t time;
+  if (HostFrame::parse(frame, len, seq, time)) {
+    if (!HostFrame::verify(frame, len)) {
+      bad_frames++;
+    }
+    if (frames > 1 && seq <= last_seq) {
+      out_of_order++;
+    }
+    last_seq = seq;
+    latency.add(HostSim::now_us() - time);
+  }
+  if (on_frame) {
+    on_frame(frame, len);
+  }
+}
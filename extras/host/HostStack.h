@@ -0,0 +1,69 @@
+// Model of the IP stack side of an EMAC in the host build
+
+#ifndef HOST_STACK_H_
+#define HOST_STACK_H_
+
+#include <stdint.h>
+#include "EMAC.h"
+#include "HostMemoryManager.h"
+#include "HostFrame.h"
+
+#define HOST_STACK_BACKLOG 256
+
+/** HostStack
+ *  Receives the frames of an EMAC and sends test frames over it.
+ *
+ *  With proc_us set, the received frames wait in a backlog and are processed
+ *  one per proc_us, like by the thread of a slow IP stack. They hold their
+ *  memory until processed.
+ */
+class HostStack {
+public:
+
+  HostStack(HostMemoryManager &memory);
+
+  /** Set the memory manager and the callbacks of the EMAC */
+  void attach(EMAC &emac);
+
+  /** Send a test frame with HostFrame content, returns the result of link_out or false without memory */
+  bool send(uint16_t len, uint32_t seq, uint16_t ethertype = HOST_FRAME_ETH_IPV4, bool unaligned = false, bool chained = false);
+
+  /** Send a frame with the given content, returns the result of link_out or false without memory */
+  bool send_frame(const uint8_t *data, uint16_t len);
+
+  /** Clear the counters */
+  void clear();
+
+  HostMemoryManager &memory;
+  EMAC *emac;
+  uint32_t proc_us;
+
+  bool link_up;
+  uint32_t link_changes;
+  uint32_t frames;
+  uint32_t bytes;
+  uint32_t bad_frames;     // content differs from HostFrame
+  uint32_t out_of_order;
+  uint32_t backlog_peak;
+  uint32_t tx_nomem;       // send without memory for the frame
+  uint32_t tx_failed;      // link_out returned false
+  uint32_t last_seq;
+  HostLatency latency;     // from the creation of a frame to its processing
+
+  /** Called for each processed frame */
+  mbed::Callback<void(const uint8_t *frame, uint16_t len)> on_frame;
+
+private:
+  void input(emac_mem_buf_t *buf);
+  void linkState(bool up);
+  void process(emac_mem_buf_t *buf);
+  void processNext();
+
+  emac_mem_buf_t* backlog[HOST_STACK_BACKLOG];
+  uint32_t backlogHead;
+  uint32_t backlogCount;
+  bool processing;
+  uint8_t frame[HOST_FRAME_MAX];
+};
+
+#endif
@@ -0,0 +1,23 @@
+// Checks of the host tests
+
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+#include <stdio.h>
+
+static int hostTestFailures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+      hostTestFailures++; \
+    } \
+  } while (0)
+
+/** Print the result of the test, returns the exit code */
+static inline int host_test_result(const char *name) {
+  printf("%s: %s\n", name, hostTestFailures ? "FAILED" : "passed");
+  return hostTestFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,269 @@
+#include "SimEsp.h"
+#include "HostSim.h"
+#include "mbed.h"
+
+#include <string.h>
+
+#define SIM_ESP_SPI_HEADER 12
+
+static void digitalWrite(int pin, int value) {
+#ifdef ESPHOST_RESET_PIN
+  if (pin == ESPHOST_RESET_PIN) {
+    SimEsp::instance().reset_line(value);
+  }
+#endif
+}
+
+SimEsp& SimEsp::instance() {
+  static SimEsp esp;
+  return esp;
+}
+
+SimEsp::SimEsp() :
+    spi_ready(false), booted(false), associated(false), softap(false), hung(false), power_save(1),
+    communicates(0), transactions(0), esp_rx_drops(0), tx_refused(0), air_tx_frames(0),
+    resets(0), joins(0), power_save_sets(0), control_requests(0), control_timeouts(0), host_rx_peak(0),
+    apReleasePending(false), sampleDataReadyPending(false), bootDone(0), booting(false), inReset(false), initEventPending(false), nextRxIface(0) {
+  params.spi_bytes_per_ms = 2500;     // 20 MHz SPI
+  params.spi_transaction_us = 60;
+  params.transactions_max = 32;
+  params.esp_rx_frames = 32;
+  params.esp_tx_frames = 16;
+  params.boot_ms = 1200;
+  params.join_ms = 2500;
+  params.control_ms = 5;
+  params.control_timeout_ms = 1000;
+  params.scan_ms = 1500;
+  params.scan_results = 6;
+  params.beacon_us = 0;
+  params.listen_interval = 3;
+  params.data_ready_line = true;
+  memset(ssid, 0, sizeof(ssid));
+  static const uint8_t defaultMac[6] = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01};
+  memcpy(mac, defaultMac, sizeof(mac));
+  HostSim::digital_write = mbed::callback(&digitalWrite);
+}
+
+void SimEsp::boot() {
+  booted = false;
+  hung = false;
+  associated = false;
+  softap = false;
+  power_save = 1; // minimum modem sleep is the ESP default
+  for (unsigned i = 0; i < SIM_ESP_IFACES; i++) {
+    espRx[i].clear();
+    hostTx[i].clear();
+  }
+  apHeld.clear();
+  booting = true;
+  bootDone = HostSim::now_us() + (uint64_t) params.boot_ms * 1000;
+}
+
+void SimEsp::power_on() {
+  mbed::ResetReason::host_reason() = RESET_REASON_POWER_ON;
+  boot();
+}
+
+void SimEsp::start_warm(const char *ssid) {
+  mbed::ResetReason::host_reason() = RESET_REASON_PIN_RESET;
+  booted = true;
+  booting = false;
+  initEventPending = false; // it was sent to the MCU before its reset
+  associated = (ssid != NULL);
+  memset(this->ssid, 0, sizeof(this->ssid));
+  if (ssid) {
+    strncpy(this->ssid, ssid, sizeof(this->ssid) - 1);
+  }
+}
+
+void SimEsp::reset_line(bool high) {
+  if (!high) {
+    if (!inReset) {
+      resets++;
+    }
+    inReset = true;
+    booted = false;
+    booting = false;
+    hung = false;
+  } else if (inReset) {
+    inReset = false;
+    boot();
+  }
+}
+
+bool SimEsp::air_rx(int iface, const uint8_t *data, uint16_t len) {
+  if (!booted || hung || espRx[iface].size() >= params.esp_rx_frames) {
+    esp_rx_drops++;
+    return false;
+  }
+  Frame f;
+  f.data.assign(data, data + len);
+  if (iface == 0 && params.beacon_us && power_save) {
+    apHeld.push_back(f);
+    if (!apReleasePending) {
+      uint64_t interval = (uint64_t) params.beacon_us * ((power_save > 1) ? params.listen_interval : 1);
+      uint64_t now = HostSim::now_us();
+      apReleasePending = true;
+      HostSim::call_in_us((now / interval + 1) * interval - now, mbed::callback(this, &SimEsp::apRelease));
+    }
+    return true;
+  }
+  espReceive(iface, f);
+  return true;
+}
+
+void SimEsp::espReceive(int iface, const Frame &f) {
+  if (espRx[iface].size() >= params.esp_rx_frames) {
+    esp_rx_drops++;
+    return;
+  }
+  espRx[iface].push_back(f);
+  if (params.data_ready_line && HostSim::data_ready && !sampleDataReadyPending) {
+    uint64_t now = HostSim::now_us();
+    uint64_t period = HostSim::data_ready_period_us ? HostSim::data_ready_period_us : 1;
+    sampleDataReadyPending = true;
+    HostSim::call_in_us((now / period + 1) * period - now, mbed::callback(this, &SimEsp::sampleDataReady));
+  }
+}
+
+// the next sample of the data-ready line, which is high while the ESP has frames
+void SimEsp::sampleDataReady() {
+  sampleDataReadyPending = false;
+  bool high = false;
+  for (unsigned i = 0; i < SIM_ESP_IFACES; i++) {
+    high |= !espRx[i].empty();
+  }
+  if (high && params.data_ready_line && HostSim::data_ready) {
+    HostSim::data_ready();
+  }
+}
+
+// the ESP woke up for a beacon and receives the frames the AP held
+void SimEsp::apRelease() {
+  apReleasePending = false;
+  while (!apHeld.empty()) {
+    espReceive(0, apHeld.front());
+    apHeld.pop_front();
+  }
+}
+
+void SimEsp::init_spi() {
+  spi_ready = true;
+}
+
+void SimEsp::communicate() {
+  if (on_communicate) {
+    on_communicate();
+  }
+  if (!spi_ready)
+    return;
+  communicates++;
+  if (booting && HostSim::now_us() >= bootDone) {
+    booting = false;
+    booted = true;
+    initEventPending = true;
+  }
+  if (!booted || hung) {
+    HostSim::busy(params.spi_transaction_us);
+    return;
+  }
+  if (initEventPending && init_event) {
+    initEventPending = false;
+    init_event();
+  }
+  transfer();
+}
+
+// full duplex SPI transactions, each moves up to one frame in each direction
+void SimEsp::transfer() {
+  HostSim::busy(params.spi_transaction_us); // the status poll
+  for (uint32_t t = 0; t < params.transactions_max; t++) {
+    int txIface = -1;
+    for (unsigned i = 0; i < SIM_ESP_IFACES; i++) {
+      if (!hostTx[i].empty()) {
+        txIface = i;
+        break;
+      }
+    }
+    int rxIface = -1;
+    for (unsigned i = 0; i < SIM_ESP_IFACES; i++) {
+      unsigned n = (nextRxIface + i) % SIM_ESP_IFACES;
+      if (!espRx[n].empty()) {
+        rxIface = n;
+        break;
+      }
+    }
+    if (txIface < 0 && rxIface < 0)
+      break;
+    nextRxIface = (nextRxIface + 1) % SIM_ESP_IFACES;
+    size_t bytes = 0;
+    if (txIface >= 0) {
+      bytes = hostTx[txIface].front().data.size();
+    }
+    if (rxIface >= 0 && espRx[rxIface].front().data.size() > bytes) {
+      bytes = espRx[rxIface].front().data.size();
+    }
+    HostSim::busy(params.spi_transaction_us + (bytes + SIM_ESP_SPI_HEADER) * 1000 / params.spi_bytes_per_ms);
+    transactions++;
+    if (rxIface >= 0) {
+      hostRx[rxIface].push_back(espRx[rxIface].front());
+      espRx[rxIface].pop_front();
+      uint32_t queued = hostRx[0].size() + hostRx[1].size();
+      if (queued > host_rx_peak) {
+        host_rx_peak = queued;
+      }
+    }
+    if (txIface >= 0) {
+      Frame f = hostTx[txIface].front();
+      hostTx[txIface].pop_front();
+      air_tx_frames++;
+      if (air_tx) {
+        air_tx(txIface, f.data.data(), f.data.size());
+      }
+    }
+  }
+}
+
+uint16_t SimEsp::peek_rx(int iface) const {
+  return hostRx[iface].empty() ? 0 : hostRx[iface].front().data.size();
+}
+
+uint16_t SimEsp::get_rx(int iface, uint8_t *data, uint16_t size) {
+  if (hostRx[iface].empty())
+    return 0;
+  const Frame &f = hostRx[iface].front();
+  uint16_t len = (f.data.size() < size) ? f.data.size() : size;
+  memcpy(data, f.data.data(), len);
+  hostRx[iface].pop_front();
+  return len;
+}
+
+int SimEsp::send(int iface, const uint8_t *data, uint16_t len) {
+  if (!spi_ready || hostTx[iface].size() >= params.esp_tx_frames) {
+    tx_refused++;
+    return -1;
+  }
+  Frame f;
+  f.data.assign(data, data + len);
+  hostTx[iface].push_back(f);
+  return 0;
+}
+
+bool SimEsp::control(uint32_t ms) {
+  control_requests++;
+  if (!spi_ready || !booted || hung) {
+    control_timeouts++;
+    HostSim::sleep((uint64_t) params.control_timeout_ms * 1000); // waits for the response
+    return false;
+  }
+  HostSim::busy((uint64_t) ms * 1000);
+  return true;
+}
+
+uint32_t SimEsp::esp_rx_queued(int iface) const {
+  return espRx[iface].size();
+}
+
+uint32_t SimEsp::host_rx_queued(int iface) const {
+  return hostRx[iface].size();
+}
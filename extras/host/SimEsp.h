@@ -0,0 +1,141 @@
+// Simulated ESP co-processor of the host build
+
+#ifndef SIM_ESP_H_
+#define SIM_ESP_H_
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "platform/Callback.h"
+
+#define SIM_ESP_IFACES 2
+
+/** SimEsp
+ *  The ESP and the queues of ESPHost on the MCU side. Backs the CEspControl
+ *  stub and SimTransport. The times are virtual, see HostSim.
+ *
+ *  Frames from the air wait in the ESP, which has room for params.esp_rx_frames
+ *  of them. communicateWithEsp moves frames in both directions over SPI into the
+ *  queues of ESPHost. The MCU side queues have no limit, like the ESPHost
+ *  messages allocated on the heap, and their peak is reported.
+ *
+ *  With params.beacon_us set, modem sleep is modelled: in power save mode the
+ *  AP holds the frames for the station until the ESP wakes up for a beacon,
+ *  every beacon with minimum and every params.listen_interval beacons with
+ *  maximum modem sleep. A frame arriving in the ESP raises the data-ready line.
+ *
+ *  A hung ESP doesn't answer on SPI: no frames move, control requests time out
+ *  and ESPHost refuses frames to send when its TX queue is full. A pulse on the
+ *  reset line (ESPHOST_RESET_PIN over digitalWrite) reboots it.
+ *
+ *  The timing values are parameters of the model, not measurements.
+ */
+class SimEsp {
+public:
+
+  struct Params {
+    uint32_t spi_bytes_per_ms;       // SPI data rate
+    uint32_t spi_transaction_us;     // overhead of an SPI transaction
+    uint32_t transactions_max;       // SPI transactions of one communicateWithEsp
+    uint32_t esp_rx_frames;          // frames the ESP buffers, more are dropped
+    uint32_t esp_tx_frames;          // frames queued for TX in ESPHost, more are refused
+    uint32_t boot_ms;                // from the reset to the init event
+    uint32_t join_ms;                // connectAccessPoint
+    uint32_t control_ms;             // other control requests
+    uint32_t control_timeout_ms;     // a control request without response
+    uint32_t scan_ms;
+    uint32_t scan_results;           // access points found by a scan
+    uint32_t beacon_us;              // beacon interval of the AP, 0 without the modem sleep model
+    uint32_t listen_interval;        // beacons between the wake-ups with maximum modem sleep
+    bool data_ready_line;            // the data-ready line is wired and sampled
+  };
+
+  struct Frame {
+    std::vector<uint8_t> data;
+  };
+
+  static SimEsp& instance();
+
+  SimEsp();
+
+  Params params;
+
+  /** Power on the ESP with the MCU, it boots and sends the init event */
+  void power_on();
+
+  /** The ESP kept running over a pin reset of the MCU, associated with ssid if not NULL */
+  void start_warm(const char *ssid);
+
+  /** The reset line, low holds the ESP in reset, high boots it */
+  void reset_line(bool high);
+
+  /** A frame arrives from the air, returns false if the ESP dropped it */
+  bool air_rx(int iface, const uint8_t *data, uint16_t len);
+
+  /** Called for each frame the ESP sends to the air */
+  mbed::Callback<void(int iface, const uint8_t *data, uint16_t len)> air_tx;
+
+  /** Called at the start of each communicateWithEsp, for tests which change state in the middle of a receive task run */
+  mbed::Callback<void()> on_communicate;
+
+  // ESPHost API, called by the CEspControl stub and SimTransport
+  void init_spi();
+  void communicate();
+  uint16_t peek_rx(int iface) const;
+  uint16_t get_rx(int iface, uint8_t *data, uint16_t size);
+  int send(int iface, const uint8_t *data, uint16_t len);
+  bool control(uint32_t ms); // a control request taking ms, false without response
+
+  /** Called from communicate when the ESP finished booting, set by listenForInitEvent */
+  mbed::Callback<void()> init_event;
+
+  /** Frames from the air waiting in the ESP */
+  uint32_t esp_rx_queued(int iface) const;
+
+  /** Frames waiting in the ESPHost queue on the MCU */
+  uint32_t host_rx_queued(int iface) const;
+
+  // ESP state
+  bool spi_ready;
+  bool booted;
+  bool associated;
+  char ssid[33];
+  bool softap;
+  bool hung;                  // the firmware doesn't respond until a reset
+  int power_save;
+  uint8_t mac[6];
+
+  // counters
+  uint32_t communicates;
+  uint32_t transactions;
+  uint32_t esp_rx_drops;      // frames from the air dropped by the ESP
+  uint32_t tx_refused;        // sendBuffer with a full TX queue
+  uint32_t air_tx_frames;
+  uint32_t resets;
+  uint32_t joins;
+  uint32_t power_save_sets;
+  uint32_t control_requests;
+  uint32_t control_timeouts;
+  uint32_t host_rx_peak;      // max frames in the ESPHost RX queues
+
+private:
+  void boot();
+  void transfer();
+  void espReceive(int iface, const Frame &f);
+  void apRelease();
+  void sampleDataReady();
+
+  std::deque<Frame> espRx[SIM_ESP_IFACES];   // in the ESP
+  std::deque<Frame> hostRx[SIM_ESP_IFACES];  // in ESPHost on the MCU
+  std::deque<Frame> hostTx[SIM_ESP_IFACES];
+  std::deque<Frame> apHeld;                  // at the AP for the station in modem sleep
+  bool apReleasePending;
+  bool sampleDataReadyPending;
+  uint64_t bootDone;
+  bool booting;
+  bool inReset;
+  bool initEventPending;
+  unsigned nextRxIface;
+};
+
+#endif
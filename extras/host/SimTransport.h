@@ -0,0 +1,45 @@
+// Transport of ESPHostEMACBase over the simulated ESP, without the ESPHost API
+
+#ifndef SIM_TRANSPORT_H_
+#define SIM_TRANSPORT_H_
+
+#include "ESPHostEMAC_config.h"
+#include "HostSim.h"
+#include "SimEsp.h"
+
+/** SimTransport
+ *  Transport policy of ESPHostEMACBase over SimEsp, on the host platform.
+ */
+struct SimTransport : HostPlatform {
+
+  static constexpr int OK = 0;
+
+  static void communicate() {
+    SimEsp::instance().communicate();
+  }
+
+  static uint16_t peek_rx(ESPHostInterface iface) {
+    return SimEsp::instance().peek_rx(iface);
+  }
+
+  static void get_rx(ESPHostInterface iface, uint8_t *data, uint16_t size) {
+    SimEsp::instance().get_rx(iface, data, size);
+  }
+
+  static int send(ESPHostInterface iface, uint8_t *data, uint16_t len) {
+    return SimEsp::instance().send(iface, data, len);
+  }
+
+  static bool get_hwaddr(ESPHostInterface iface, uint8_t *addr) {
+    SimEsp &esp = SimEsp::instance();
+    if (!esp.control(esp.params.control_ms))
+      return false;
+    for (unsigned i = 0; i < 6; i++) {
+      addr[i] = esp.mac[i];
+    }
+    addr[5] += iface;
+    return true;
+  }
+};
+
+#endif
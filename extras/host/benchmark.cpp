@@ -0,0 +1,97 @@
+// The benchmark core of ESPHostBenchmark run on the host: the same tests with
+// the host sockets over ESPHostEMACInterface and the simulated ESP, against a
+// simulated peer. It prints the results like the sketch does on the board.
+// A peer which leaves the TCP connection half-open and an echo reply which
+// comes after the timeout of its probe are checked too, and the UDP TX tests
+// against the sequence numbers of an iperf2 server.
+
+#include "HostTest.h"
+#include "HostSim.h"
+#include "HostSocket.h"
+#include "SimEsp.h"
+#include "ESPHostEMACInterface.h"
+#include "BenchmarkCore.h"
+
+static const uint64_t SECOND_US = 1000000;
+static const uint32_t TCP_STREAM_BYTES = 1000000;
+static const uint32_t UDP_STREAM_DATAGRAMS = 2000;
+
+static HostTcpServer server(IPERF_PORT);
+static HostUdp udp;
+static Benchmark<HostTcpClient, HostTcpServer, HostUdp> benchmark(server, udp, Serial, IPAddress(192, 168, 1, 100));
+
+static void tcpStream() {
+  HostNet::instance().start_tcp_stream(TCP_STREAM_BYTES, true);
+}
+
+static void tcpStreamHalfOpen() {
+  HostNet::instance().start_tcp_stream(TCP_STREAM_BYTES, false);
+}
+
+static void udpStream() {
+  HostNet::instance().start_udp_stream(IPERF_PORT, BULK_SIZE, UDP_STREAM_DATAGRAMS);
+}
+
+int main() {
+  SimEsp &esp = SimEsp::instance();
+  esp.power_on();
+  ESPHostEMACInterface wifi;
+  CHECK(wifi.connect("test", "password", NSAPI_SECURITY_WPA2) == NSAPI_ERROR_OK);
+  HostNet &net = HostNet::instance();
+  net.attach(wifi.host_stack());
+  server.begin();
+  HostSim::run_for(SECOND_US);
+
+  BenchmarkResult r = benchmark.run('t');
+  HostSim::run_for(SECOND_US);
+  CHECK(r.ok && r.bytes > 0);
+  CHECK(net.tcp_bytes == r.bytes);
+  CHECK(r.emac.tx_frames == r.bytes / BULK_SIZE);
+
+  HostSim::call_in_us(SECOND_US, mbed::callback(&tcpStream));
+  r = benchmark.run('r');
+  CHECK(r.ok && r.bytes == TCP_STREAM_BYTES);
+
+  // the peer disappears after the stream, the test ends without the FIN
+  HostSim::call_in_us(SECOND_US, mbed::callback(&tcpStreamHalfOpen));
+  uint64_t start = HostSim::now_us();
+  r = benchmark.run('r');
+  CHECK(r.ok && r.bytes == TCP_STREAM_BYTES);
+  CHECK(HostSim::now_us() - start < (TEST_DURATION + 2 * TCP_IDLE_TIMEOUT) * 1000);
+
+  r = benchmark.run('u');
+  HostSim::run_for(SECOND_US);
+  CHECK(r.ok && r.packets > 0);
+  CHECK(net.udp_datagrams == r.packets);
+  CHECK(net.udp_lost == 0 && net.udp_out_of_order == 0);
+  CHECK(net.udp_fins == 1); // answered at the first final datagram
+
+  uint32_t espDrops = esp.esp_rx_drops;
+  uint32_t socketDrops = net.rx_drops;
+  HostSim::call_in_us(SECOND_US, mbed::callback(&udpStream));
+  r = benchmark.run('v');
+  CHECK(r.ok && r.packets > 0);
+  CHECK(r.packets + (esp.esp_rx_drops - espDrops) + (net.rx_drops - socketDrops) == UDP_STREAM_DATAGRAMS);
+
+  // the reply to the 10th probe comes after its timeout and must not be taken for the 11th
+  net.params.late_echo = net.echoes + 10;
+  net.params.late_echo_us = ECHO_TIMEOUT + ECHO_TIMEOUT / 2;
+  r = benchmark.run('e');
+  CHECK(r.ok);
+  CHECK(r.replies == ECHO_COUNT - 1);
+  CHECK(r.stale == 1);
+  CHECK(r.rttMin >= net.params.echo_delay_us);
+  CHECK(r.rttMax < ECHO_TIMEOUT / 4);
+
+  uint32_t datagrams = net.udp_datagrams;
+  r = benchmark.run('p');
+  HostSim::run_for(SECOND_US);
+  CHECK(r.ok && r.packets > 0);
+  CHECK(net.udp_datagrams - datagrams == r.packets);
+  CHECK(net.udp_lost == 0 && net.udp_out_of_order == 0);
+  CHECK(net.udp_fins == 2);
+
+  wifi.disconnect();
+  HostSim::run_for(SECOND_US);
+  return host_test_result("benchmark");
+}
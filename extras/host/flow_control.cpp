@@ -0,0 +1,145 @@
+// RX flow control: an RX flood into a slow stack must not lose frames in the EMAC,
+// must not pile the frames up in the ESPHost queue while RX is paused and must
+// not stall on a heap too small or too fragmented for the resume headroom.
+// Without memory pressure no buffer is allocated to probe the headroom.
+
+#include "HostTest.h"
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimTransport.h"
+#include "ESPHostEMAC_impl.h"
+
+// a large heap can use a hysteresis between the pause and the resume
+struct HysteresisConfig : ESPHostEMACConfig {
+  static constexpr uint8_t rx_pause_headroom = 2;
+  static constexpr uint8_t rx_resume_headroom = 8;
+};
+
+// the RX period of a receive task run
+static const uint32_t RX_PERIOD_US = std::chrono::microseconds(ESPHostEMACConfig::receive_task_period).count();
+
+// the air side sends the next frame when the ESP has room, like a sender which retries
+static struct {
+  uint32_t sent;
+  uint32_t count;
+  uint16_t len;
+  uint64_t interval_us;
+} flood;
+
+static void floodNext() {
+  SimEsp &esp = SimEsp::instance();
+  if (flood.sent == flood.count)
+    return;
+  if (esp.esp_rx_queued(ESPHOST_STATION) < esp.params.esp_rx_frames) {
+    uint8_t frame[HOST_FRAME_MAX];
+    flood.sent++;
+    HostFrame::build(frame, flood.len, HOST_FRAME_ETH_IPV4, flood.sent, HostSim::now_us());
+    esp.air_rx(ESPHOST_STATION, frame, flood.len);
+  }
+  HostSim::call_in_us(flood.interval_us, mbed::callback(&floodNext));
+}
+
+static bool floodDone(HostStack *stack) {
+  return stack->frames == flood.count;
+}
+
+template<class EMAC>
+static void run(const char *name, HostMemoryManager &memory, uint32_t proc_us, uint32_t count, uint16_t len, uint32_t tx_count) {
+  SimEsp &esp = SimEsp::instance();
+  EMAC &emac = EMAC::get_instance();
+  HostStack stack(memory);
+  stack.proc_us = proc_us;
+  stack.attach(emac);
+  emac.power_up();
+  uint32_t hostRxPeak = esp.host_rx_peak = 0;
+  uint32_t airTx = esp.air_tx_frames;
+
+  flood.sent = 0;
+  flood.count = count;
+  flood.len = len;
+  flood.interval_us = 500;
+  uint64_t start = HostSim::now_us();
+  floodNext();
+  // the stack sends while RX is paused
+  for (uint32_t i = 0; i < tx_count; i++) {
+    HostSim::run_for(RX_PERIOD_US);
+    CHECK(stack.send(HOST_FRAME_MIN, i + 1));
+  }
+  bool done = HostSim::run_until(mbed::Callback<bool()>([&stack]() { return floodDone(&stack); }), 60000000);
+  HostSim::run_for(100000);
+  hostRxPeak = esp.host_rx_peak;
+
+  ESPHostEMACStats stats;
+  emac.get_stats(stats);
+  printf("%s: %u frames in %u ms, %u pauses, stack backlog peak %u, ESPHost queue peak %u, heap peak %u\n", name,
+      (unsigned) stack.frames, (unsigned) ((HostSim::now_us() - start) / 1000), (unsigned) stats.rx_pauses,
+      (unsigned) stack.backlog_peak, (unsigned) hostRxPeak, (unsigned) memory.heap_peak);
+  CHECK(done);
+  CHECK(stack.frames == count);
+  CHECK(stats.rx_frames == count);
+  CHECK(stack.out_of_order == 0);
+  CHECK(stack.bad_frames == 0);
+  CHECK(stats.rx_pauses > 0);
+  CHECK(!emac.is_rx_paused());
+  // one exchange pulls the frames the ESP has ready, and at most rx_pause_tx_exchanges
+  // exchanges to send follow until the ESPHost queue is empty again
+  CHECK(hostRxPeak <= esp.params.esp_rx_frames * (1 + ESPHostEMACConfig::rx_pause_tx_exchanges));
+  CHECK(esp.air_tx_frames - airTx == tx_count);
+  CHECK(stats.tx_errors == 0);
+
+  emac.power_down();
+  HostSim::run_for(100000);
+}
+
+// a stack which keeps up: one allocation for each frame, none for the headroom
+static void noPressure() {
+  ESPHostEMACBase<SimTransport> &emac = ESPHostEMACBase<SimTransport>::get_instance();
+  HostMemoryManager memory;
+  HostStack stack(memory);
+  stack.proc_us = 100;
+  stack.attach(emac);
+  emac.power_up();
+
+  flood.sent = 0;
+  flood.count = 100;
+  flood.len = 1514;
+  flood.interval_us = 2000;
+  floodNext();
+  bool done = HostSim::run_until(mbed::Callback<bool()>([&stack]() { return floodDone(&stack); }), 10000000);
+
+  printf("no pressure: %u frames, %u pauses, %u allocations\n", (unsigned) stack.frames,
+      (unsigned) emac.get_rx_pause_count(), (unsigned) emac.get_datapath_heap_allocs());
+  CHECK(done);
+  CHECK(emac.get_rx_pause_count() == 0);
+  CHECK(emac.get_datapath_heap_allocs() == flood.count);
+
+  emac.power_down();
+  HostSim::run_for(100000);
+}
+
+int main() {
+  SimEsp &esp = SimEsp::instance();
+  esp.init_spi();
+  esp.start_warm("test");
+
+  noPressure();
+
+  // a heap of 64 kB and a stack which needs 10 ms for a frame, slower than the RX bursts
+  HostMemoryManager memory;
+  run<ESPHostEMACBase<SimTransport> >("64 kB heap", memory, 10000, 300, 1514, 10);
+  HostMemoryManager hysteresis;
+  run<ESPHostEMACBase<SimTransport, HysteresisConfig> >("64 kB heap, hysteresis", hysteresis, 10000, 300, 1514, 0);
+
+  // the default 1.6 kB lwIP heap of Mbed OS has room for one frame
+  HostMemoryManager small;
+  small.set_heap(1600);
+  run<ESPHostEMACBase<SimTransport> >("1.6 kB heap", small, 2000, 100, 1514, 0);
+
+  // a fragmented heap never has an MTU sized block, the pauses end after rx_pause_max,
+  // the frames fit its blocks and a stack of 20 ms per frame uses them up
+  HostMemoryManager fragmented;
+  fragmented.set_heap(16000, 1000);
+  run<ESPHostEMACBase<SimTransport> >("fragmented heap", fragmented, 20000, 50, 600, 0);
+
+  return host_test_result("flow_control");
+}
@@ -0,0 +1,183 @@
+// Packet capture: the frames of the EMAC written with write_pcap to a file and
+// read back as the libpcap file format specifies it. make check reads the
+// file with tcpdump and capinfos too, if they are installed. A capture of an
+// EMAC with another Config keeps the snaplen and ring size of that Config.
+
+#include "HostTest.h"
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimTransport.h"
+#include "ESPHostEMAC_impl.h"
+#include "ESPHostEMACCapture.h"
+
+#define ETH_TYPE_TX 0x0806 // TX frames get an other EtherType to tell them apart
+
+typedef ESPHostEMACBase<SimTransport> SimEMAC;
+
+struct SmallCaptureConfig : ESPHostEMACConfig {
+  static constexpr uint16_t capture_snaplen = 20;
+  static constexpr uint16_t capture_ring_size = 4;
+};
+
+/** Print to a file */
+class FilePrint : public arduino::Print {
+public:
+  explicit FilePrint(FILE *f) : f(f) {}
+  size_t write(uint8_t b) {
+    return fwrite(&b, 1, 1, f);
+  }
+  size_t write(const uint8_t *buffer, size_t size) {
+    return fwrite(buffer, 1, size, f);
+  }
+private:
+  FILE *f;
+};
+
+static uint32_t get32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+int main(int argc, char **argv) {
+  const char *path = (argc > 1) ? argv[1] : "build/capture.pcap";
+  SimEsp &esp = SimEsp::instance();
+  esp.init_spi();
+  esp.start_warm("test");
+
+  HostMemoryManager memory;
+  HostStack stack(memory);
+  SimEMAC &emac = SimEMAC::get_instance();
+  stack.attach(emac);
+  ESPHostEMACCapture capture;
+  emac.set_capture(&capture);
+  CHECK(emac.power_up());
+  capture.start();
+
+  // more frames than the ring keeps, of lengths below and above the snaplen
+  const unsigned rxCount = 40;
+  unsigned txCount = 0;
+  for (unsigned i = 1; i <= rxCount; i++) {
+    uint8_t frame[HOST_FRAME_MAX];
+    uint16_t len = (i % 5 == 0) ? HOST_FRAME_MIN : HOST_FRAME_MIN + i * 37;
+    HostFrame::build(frame, len, HOST_FRAME_ETH_IPV4, i, HostSim::now_us());
+    CHECK(esp.air_rx(ESPHOST_STATION, frame, len));
+    if (i % 4 == 0) {
+      txCount++;
+      CHECK(stack.send(HOST_FRAME_MIN + 100, txCount, ETH_TYPE_TX));
+    }
+    HostSim::run_for(5000);
+  }
+  HostSim::run_for(100000);
+  capture.stop();
+  CHECK(stack.frames == rxCount);
+  CHECK(capture.get_captured_count() == rxCount + txCount);
+
+  FILE *f = fopen(path, "wb");
+  CHECK(f != NULL);
+  if (f == NULL)
+    return host_test_result("pcap_export");
+  FilePrint out(f);
+  size_t written = capture.write_pcap(out);
+  fclose(f);
+  CHECK(written == ESPHostEMACConfig::capture_ring_size);
+
+  // read it back
+  static uint8_t file[64 * 1024];
+  f = fopen(path, "rb");
+  CHECK(f != NULL);
+  if (f == NULL)
+    return host_test_result("pcap_export");
+  size_t size = fread(file, 1, sizeof(file), f);
+  fclose(f);
+
+  // global header, little endian: magic, version 2.4, snaplen, link type
+  CHECK(size >= 24);
+  CHECK(get32(file) == 0xa1b2c3d4);
+  CHECK(get16(file + 4) == 2 && get16(file + 6) == 4);
+  CHECK(get32(file + 8) == 0 && get32(file + 12) == 0);
+  uint32_t snaplen = get32(file + 16);
+  CHECK(snaplen == ESPHostEMACConfig::capture_snaplen);
+  CHECK(get32(file + 20) == 1); // LINKTYPE_ETHERNET
+
+  size_t pos = 24;
+  unsigned records = 0;
+  unsigned rx = 0;
+  unsigned tx = 0;
+  uint32_t lastRxSeq = 0;
+  uint32_t lastTxSeq = 0;
+  uint64_t lastTime = 0;
+  while (pos + 16 <= size) {
+    uint64_t time = (uint64_t) get32(file + pos) * 1000000 + get32(file + pos + 4);
+    uint32_t caplen = get32(file + pos + 8);
+    uint32_t len = get32(file + pos + 12);
+    CHECK(get32(file + pos + 4) < 1000000);
+    CHECK(time >= lastTime);
+    CHECK(caplen <= snaplen && caplen <= len);
+    CHECK(caplen == ((len < snaplen) ? len : snaplen));
+    CHECK(pos + 16 + caplen <= size);
+    if (pos + 16 + caplen > size)
+      break;
+    const uint8_t *data = file + pos + 16;
+    uint32_t seq = 0;
+    uint64_t created = 0;
+    CHECK(HostFrame::parse(data, caplen, seq, created));
+    for (uint32_t i = HOST_FRAME_MIN; i < caplen; i++) {
+      CHECK(data[i] == (uint8_t) (seq + i));
+    }
+    if (HostFrame::ethertype(data) == ETH_TYPE_TX) {
+      CHECK(lastTxSeq == 0 || seq == lastTxSeq + 1);
+      lastTxSeq = seq;
+      tx++;
+    } else {
+      CHECK(lastRxSeq == 0 || seq == lastRxSeq + 1);
+      lastRxSeq = seq;
+      rx++;
+    }
+    lastTime = time;
+    pos += 16 + caplen;
+    records++;
+  }
+  CHECK(pos == size);
+  CHECK(records == written);
+  CHECK(lastRxSeq == rxCount);
+  CHECK(lastTxSeq == txCount);
+  printf("%s: %u records, %u RX and %u TX, %u bytes\n", path, records, rx, tx, (unsigned) size);
+
+  emac.set_capture(NULL);
+  emac.power_down();
+  HostSim::run_for(100000);
+
+  ESPHostEMACBase<SimTransport, SmallCaptureConfig> &smallEmac = ESPHostEMACBase<SimTransport, SmallCaptureConfig>::get_instance();
+  stack.attach(smallEmac);
+  ESPHostEMACCaptureBase<SmallCaptureConfig> smallCapture;
+  smallEmac.set_capture(&smallCapture);
+  CHECK(smallEmac.power_up());
+  smallCapture.start();
+  for (unsigned i = 1; i <= 10; i++) {
+    uint8_t frame[HOST_FRAME_MAX];
+    HostFrame::build(frame, HOST_FRAME_MIN + 100, HOST_FRAME_ETH_IPV4, i, HostSim::now_us());
+    CHECK(esp.air_rx(ESPHOST_STATION, frame, HOST_FRAME_MIN + 100));
+    HostSim::run_for(5000);
+  }
+  f = tmpfile();
+  CHECK(f != NULL);
+  if (f == NULL)
+    return host_test_result("pcap_export");
+  FilePrint smallOut(f);
+  written = smallCapture.write_pcap(smallOut);
+  size = ftell(f);
+  rewind(f);
+  size = fread(file, 1, size, f);
+  fclose(f);
+  printf("capture of another Config: %u records, %u bytes\n", (unsigned) written, (unsigned) size);
+  CHECK(written == SmallCaptureConfig::capture_ring_size);
+  CHECK(get32(file + 16) == SmallCaptureConfig::capture_snaplen);
+  CHECK(size == 24 + written * (16 + SmallCaptureConfig::capture_snaplen));
+  smallEmac.set_capture(NULL);
+  smallEmac.power_down();
+  HostSim::run_for(100000);
+  return host_test_result("pcap_export");
+}
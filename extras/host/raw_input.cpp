@@ -0,0 +1,128 @@
+// EtherType handlers: frames for a handler bypass the IP stack, but not the RX
+// flow control, and take no buffer of the memory manager. A frame for the stack
+// whose buffer can't be allocated waits in the EMAC, so a flood into a full heap
+// loses nothing.
+
+#include "HostTest.h"
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimTransport.h"
+#include "ESPHostEMAC_impl.h"
+
+#define ETH_TYPE_RAW 0x88b5 // local experimental EtherType
+
+// RX buffers from the pool, a frame larger than a pool unit is a chain
+struct PoolConfig : ESPHostEMACConfig {
+  static constexpr bool static_alloc = true;
+};
+
+static struct {
+  uint32_t frames;
+  uint32_t bad_frames;
+  uint32_t last_seq;
+  uint32_t out_of_order;
+} raw;
+
+static void rawFrame(const uint8_t *frame, uint16_t len) {
+  uint32_t seq;
+  uint64_t time;
+  raw.frames++;
+  if (HostFrame::ethertype(frame) != ETH_TYPE_RAW || !HostFrame::verify(frame, len) || !HostFrame::parse(frame, len, seq, time)) {
+    raw.bad_frames++;
+    return;
+  }
+  if (seq <= raw.last_seq) {
+    raw.out_of_order++;
+  }
+  raw.last_seq = seq;
+}
+
+// the air side sends the next frame when the ESP has room, every raw_every-th for the handler
+static struct {
+  uint32_t sent;
+  uint32_t count;
+  uint16_t len;
+  uint32_t raw_every;
+} flood;
+
+static void floodNext() {
+  SimEsp &esp = SimEsp::instance();
+  if (flood.sent == flood.count)
+    return;
+  if (esp.esp_rx_queued(ESPHOST_STATION) < esp.params.esp_rx_frames) {
+    uint8_t frame[HOST_FRAME_MAX];
+    flood.sent++;
+    uint16_t ethertype = (flood.sent % flood.raw_every) ? HOST_FRAME_ETH_IPV4 : ETH_TYPE_RAW;
+    HostFrame::build(frame, flood.len, ethertype, flood.sent, HostSim::now_us());
+    esp.air_rx(ESPHOST_STATION, frame, flood.len);
+  }
+  HostSim::call_in_us(500, mbed::callback(&floodNext));
+}
+
+static bool floodDone(HostStack *stack) {
+  return stack->frames + raw.frames == flood.count;
+}
+
+template<class EMAC>
+static void run(const char *name, HostMemoryManager &memory, uint32_t proc_us, uint32_t count, uint16_t len, bool pressure) {
+  EMAC &emac = EMAC::get_instance();
+  HostStack stack(memory);
+  stack.proc_us = proc_us;
+  stack.attach(emac);
+  memset(&raw, 0, sizeof(raw));
+  CHECK(emac.add_ethertype_handler(ETH_TYPE_RAW, mbed::callback(&rawFrame)));
+  emac.power_up();
+
+  flood.sent = 0;
+  flood.count = count;
+  flood.len = len;
+  flood.raw_every = 2;
+  floodNext();
+  bool done = HostSim::run_until(mbed::Callback<bool()>([&stack]() { return floodDone(&stack); }), 60000000);
+  HostSim::run_for(100000);
+
+  ESPHostEMACStats stats;
+  emac.get_stats(stats);
+  uint32_t buffers = memory.heap_allocs + memory.pool_allocs;
+  printf("%s: %u frames to the handler, %u to the stack, %u pauses, %u buffers, heap peak %u\n", name,
+      (unsigned) raw.frames, (unsigned) stack.frames, (unsigned) stats.rx_pauses, (unsigned) buffers,
+      (unsigned) memory.heap_peak);
+  CHECK(done);
+  CHECK(raw.frames == count / 2);
+  CHECK(stack.frames == count - count / 2);
+  CHECK(raw.bad_frames == 0);
+  CHECK(raw.out_of_order == 0);
+  CHECK(stack.bad_frames == 0);
+  CHECK(stack.out_of_order == 0);
+  CHECK(memory.heap_used == 0);
+  CHECK(memory.pool_used == 0);
+  if (!pressure) { // else the headroom is probed
+    CHECK(stats.rx_pauses == 0);
+    CHECK(buffers == stack.frames);
+  }
+
+  emac.power_down();
+  emac.remove_ethertype_handler(ETH_TYPE_RAW);
+  HostSim::run_for(100000);
+}
+
+int main() {
+  SimEsp &esp = SimEsp::instance();
+  esp.init_spi();
+  esp.start_warm("test");
+
+  HostMemoryManager memory;
+  run<ESPHostEMACBase<SimTransport> >("64 kB heap", memory, 0, 100, 1514, false);
+
+  // a chained pool buffer is only used for the frames to the stack
+  HostMemoryManager pool;
+  pool.set_pool(16);
+  run<ESPHostEMACBase<SimTransport, PoolConfig> >("pool", pool, 0, 100, 1514, false);
+
+  // the default 1.6 kB lwIP heap of Mbed OS and a slow stack, RX pauses and nothing is lost
+  HostMemoryManager small;
+  small.set_heap(1600);
+  run<ESPHostEMACBase<SimTransport> >("1.6 kB heap", small, 2000, 100, 1514, true);
+
+  return host_test_result("raw_input");
+}
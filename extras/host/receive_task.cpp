@@ -0,0 +1,138 @@
+// The receive task: one chain of it over a power_down and power_up while it
+// runs, and the wake-ups and the RX latency of the latency profiles of
+// ESPHostEMACInterface, with modem sleep modelled in the simulated ESP.
+
+#include "HostTest.h"
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimTransport.h"
+#include "ESPHostEMAC_impl.h"
+#include "ESPHostEMACInterface.h"
+
+typedef ESPHostEMACBase<SimTransport> SimEMAC;
+
+static const uint64_t SECOND_US = 1000000;
+
+static void restart() {
+  SimEsp::instance().on_communicate = nullptr;
+  SimEMAC &emac = SimEMAC::get_instance();
+  emac.power_down(); // can't cancel the running receive task
+  emac.power_up();
+}
+
+// power_down and power_up while the receive task runs, like from another thread
+static void restartWhileRunning() {
+  SimEsp &esp = SimEsp::instance();
+  esp.init_spi();
+  esp.start_warm("test");
+  HostMemoryManager memory;
+  HostStack stack(memory);
+  SimEMAC &emac = SimEMAC::get_instance();
+  stack.attach(emac);
+  CHECK(emac.power_up());
+  HostSim::run_for(100000);
+
+  esp.on_communicate = mbed::callback(&restart);
+  HostSim::run_for(100000);
+  CHECK(!esp.on_communicate);
+  uint32_t wakeups = SimEMAC::get_wakeup_count();
+  HostSim::run_for(SECOND_US);
+  wakeups = SimEMAC::get_wakeup_count() - wakeups;
+  uint32_t expected = SECOND_US / std::chrono::microseconds(ESPHostEMACConfig::receive_task_period).count();
+  printf("restart while running: %u wake-ups/s, %u expected\n", (unsigned) wakeups, (unsigned) expected);
+  CHECK(wakeups <= expected + 1);
+
+  emac.power_down();
+  HostSim::run_for(100000);
+  CHECK(HostSim::pending() == 0);
+}
+
+// frames at random times, far enough apart that the receive task goes idle in between
+static uint32_t lcgState = 1;
+static uint32_t rxSeq = 0;
+static uint32_t rxLeft = 0;
+
+static uint32_t lcg(uint32_t range) {
+  lcgState = lcgState * 1103515245 + 12345;
+  return (lcgState >> 16) % range;
+}
+
+static void sparseRx() {
+  if (rxLeft == 0)
+    return;
+  rxLeft--;
+  uint8_t frame[HOST_FRAME_MAX];
+  HostFrame::build(frame, 100, HOST_FRAME_ETH_IPV4, ++rxSeq, HostSim::now_us());
+  SimEsp::instance().air_rx(ESPHOST_STATION, frame, 100);
+  HostSim::call_in_us(400000 + lcg(200000), mbed::callback(&sparseRx));
+}
+
+struct ProfileResult {
+  int power_save;
+  double idleWakeups;
+  double rxWakeups;
+  uint64_t latencyAvg;
+  uint64_t latencyP99;
+  uint32_t frames;
+};
+
+static ProfileResult runProfile(const char *name, ESPHostEMACInterface &wifi, ESPHostEMACInterface::latency_profile_t profile, bool dataReady) {
+  SimEsp &esp = SimEsp::instance();
+  HostStack &stack = wifi.host_stack();
+  esp.params.data_ready_line = dataReady;
+  CHECK(wifi.set_latency_profile(profile) == NSAPI_ERROR_OK);
+  HostSim::run_for(SECOND_US);
+
+  ProfileResult r;
+  r.power_save = esp.power_save;
+  uint32_t wakeups = ESPHostEMAC::get_wakeup_count();
+  HostSim::run_for(10 * SECOND_US);
+  r.idleWakeups = (ESPHostEMAC::get_wakeup_count() - wakeups) / 10.0;
+
+  const uint32_t count = 40;
+  stack.clear();
+  stack.link_up = true;
+  rxLeft = count;
+  wakeups = ESPHostEMAC::get_wakeup_count();
+  uint64_t start = HostSim::now_us();
+  sparseRx();
+  HostSim::run_until(mbed::Callback<bool()>([&stack]() { return stack.frames == count; }), 60 * SECOND_US);
+  r.rxWakeups = (ESPHostEMAC::get_wakeup_count() - wakeups) * (double) SECOND_US / (HostSim::now_us() - start);
+  r.frames = stack.frames;
+  r.latencyAvg = stack.latency.avg();
+  r.latencyP99 = stack.latency.percentile(99);
+  printf("%-26s power save %d, idle %5.1f wake-ups/s, sparse RX %5.1f wake-ups/s, latency avg %6u us p99 %6u us\n",
+      name, r.power_save, r.idleWakeups, r.rxWakeups, (unsigned) r.latencyAvg, (unsigned) r.latencyP99);
+  CHECK(r.frames == count);
+  return r;
+}
+
+int main() {
+  restartWhileRunning();
+
+  SimEsp &esp = SimEsp::instance();
+  esp.params.beacon_us = 102400;
+  esp.power_on();
+  ESPHostEMACInterface wifi;
+  CHECK(wifi.connect("test", "password", NSAPI_SECURITY_WPA2) == NSAPI_ERROR_OK);
+
+  ProfileResult lowLatency = runProfile("low latency", wifi, ESPHostEMACInterface::LATENCY_PROFILE_LOW_LATENCY, true);
+  ProfileResult balanced = runProfile("balanced", wifi, ESPHostEMACInterface::LATENCY_PROFILE_BALANCED, true);
+  ProfileResult lowPower = runProfile("low power", wifi, ESPHostEMACInterface::LATENCY_PROFILE_LOW_POWER, true);
+  ProfileResult polled = runProfile("low power, no data-ready", wifi, ESPHostEMACInterface::LATENCY_PROFILE_LOW_POWER, false);
+
+  CHECK(lowLatency.power_save == 0);
+  CHECK(balanced.power_save == 1);
+  CHECK(lowPower.power_save == 2);
+  CHECK(lowLatency.idleWakeups > balanced.idleWakeups);
+  CHECK(balanced.idleWakeups > lowPower.idleWakeups);
+  CHECK(lowLatency.latencyAvg < balanced.latencyAvg);
+  CHECK(lowLatency.latencyP99 <= 2 * std::chrono::microseconds(ESPHostEMACConfig::low_latency_period).count());
+  // the data-ready line saves the wait for the idle poll
+  CHECK(lowPower.latencyAvg < polled.latencyAvg);
+  CHECK(lowPower.idleWakeups == polled.idleWakeups);
+
+  wifi.disconnect();
+  HostSim::run_for(SECOND_US);
+  return host_test_result("receive_task");
+}
@@ -0,0 +1,121 @@
+// Reset to traffic: the time from a reset of the MCU, or from a hang of the
+// ESP, to the first frame through the connected station. Each reset of the MCU
+// runs in a child process, so the interface starts from its initial state.
+//
+// cold         the ESP is powered on with the MCU, it boots and joins the AP,
+//              it isn't probed while it boots
+// warm         the ESP kept running associated with the AP over a pin reset of
+//              the MCU, no new join, and the power save mode of the profile is
+//              set again
+// warm, other  the ESP kept running associated with another AP, it joins
+// recovery     the ESP hangs, it is reset without probing it while it boots
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include "HostTest.h"
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimEsp.h"
+#include "ESPHostEMACInterface.h"
+
+static const uint64_t SECOND_US = 1000000;
+static const uint64_t SEND_INTERVAL_US = 10000;
+
+enum Case {
+  COLD, WARM, WARM_OTHER_SSID, RECOVERY, CASE_COUNT
+};
+
+static const char *caseNames[CASE_COUNT] = {"cold", "warm", "warm, other ssid", "recovery"};
+
+static void loopback(int iface, const uint8_t *data, uint16_t len) {
+  SimEsp::instance().air_rx(iface, data, len);
+}
+
+// sends a frame every SEND_INTERVAL_US until one comes back, returns the time
+static uint64_t firstTraffic(HostStack &stack) {
+  uint32_t frames = stack.frames;
+  uint32_t seq = 0;
+  uint64_t limit = HostSim::now_us() + 30 * SECOND_US;
+  while (stack.frames == frames && HostSim::now_us() < limit) {
+    stack.send(HOST_FRAME_MIN + 100, ++seq);
+    HostSim::sleep(SEND_INTERVAL_US);
+  }
+  return HostSim::now_us();
+}
+
+static int run(Case c) {
+  SimEsp &esp = SimEsp::instance();
+  esp.air_tx = mbed::callback(&loopback);
+  if (c == WARM) {
+    esp.start_warm("test");
+    esp.power_save = 2; // the application before the reset used maximum modem sleep
+  } else if (c == WARM_OTHER_SSID) {
+    esp.start_warm("other");
+  } else {
+    esp.power_on();
+  }
+
+  uint64_t start = HostSim::now_us();
+  uint32_t timeouts = esp.control_timeouts;
+  ESPHostEMACInterface wifi;
+  CHECK(wifi.connect("test", "password", NSAPI_SECURITY_WPA2) == NSAPI_ERROR_OK);
+  HostStack &stack = wifi.host_stack();
+  if (c == RECOVERY) {
+    firstTraffic(stack);
+    HostSim::run_for(SECOND_US);
+    timeouts = esp.control_timeouts;
+    start = HostSim::now_us();
+    esp.hung = true;
+    HostSim::run_until(mbed::Callback<bool()>([&wifi]() { return wifi.get_recovery_count() > 0; }), 60 * SECOND_US);
+    printf("recovery: %d ms from the reset to the rejoined AP\n", (int) wifi.get_last_recovery_time().count());
+  }
+  uint64_t traffic = firstTraffic(stack);
+
+  printf("%-17s %5u ms to traffic, %u joins, %u resets, %u control timeouts, power save %d\n", caseNames[c],
+      (unsigned) ((traffic - start) / 1000), (unsigned) esp.joins, (unsigned) esp.resets,
+      (unsigned) (esp.control_timeouts - timeouts), esp.power_save);
+  CHECK(stack.frames > 0);
+  CHECK(esp.power_save == 1); // of the balanced profile
+  switch (c) {
+    case COLD:
+      CHECK(esp.joins == 1);
+      CHECK(esp.control_timeouts == timeouts); // no probe while the ESP boots
+      CHECK(traffic - start >= (uint64_t) (esp.params.boot_ms + esp.params.join_ms) * 1000);
+      break;
+    case WARM:
+      CHECK(esp.joins == 0);
+      CHECK(esp.power_save_sets == 1);
+      CHECK(esp.control_timeouts == timeouts);
+      CHECK(traffic - start < (uint64_t) esp.params.boot_ms * 1000);
+      break;
+    case WARM_OTHER_SSID:
+      CHECK(esp.joins == 1);
+      CHECK(esp.control_timeouts == timeouts);
+      CHECK(traffic - start < (uint64_t) (esp.params.boot_ms + esp.params.join_ms) * 1000);
+      break;
+    default:
+      CHECK(esp.resets == 1);
+      CHECK(esp.joins == 2);
+      CHECK(esp.control_timeouts - timeouts == 1); // the probe of the watchdog only
+      break;
+  }
+  wifi.disconnect();
+  HostSim::run_for(SECOND_US);
+  return hostTestFailures;
+}
+
+int main() {
+  for (int c = 0; c < CASE_COUNT; c++) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      int failures = run((Case) c);
+      fflush(stdout);
+      _exit(failures ? 1 : 0);
+    }
+    int status = 0;
+    CHECK(pid > 0 && waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+  return host_test_result("reconnect");
+}
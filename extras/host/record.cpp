@@ -0,0 +1,136 @@
+// Records an ESPHost call trace of a bursty workload for replay: bursts of full
+// size frames, an ACK sent for every second frame, idle gaps between the bursts.
+//
+//   record [TRACE]    write the trace to TRACE, build/trace.bin by default
+//
+// The trace buffer is flushed to the file in segments, replay reads them in a row.
+
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimTransport.h"
+#include "ESPHostEMAC_impl.h"
+#include "ESPHostEMACTrace.h"
+
+typedef ESPHostEMACBase<SimTransport> SimEMAC;
+
+#define RECORD_BURSTS     16
+#define RECORD_FRAME_US   500  // interval of the frames of a burst
+#define RECORD_ACK_LEN    60
+
+/** Print to a file */
+class FilePrint : public arduino::Print {
+public:
+  explicit FilePrint(FILE *f) : f(f) {}
+  size_t write(uint8_t b) {
+    return fwrite(&b, 1, 1, f);
+  }
+  size_t write(const uint8_t *buffer, size_t size) {
+    return fwrite(buffer, 1, size, f);
+  }
+private:
+  FILE *f;
+};
+
+static uint32_t lcgState = 12345;
+
+static uint32_t lcg(uint32_t range) {
+  lcgState = lcgState * 1103515245 + 12345;
+  return (lcgState >> 16) % range;
+}
+
+static HostStack *stack;
+static ESPHostEMACTrace trace;
+static FilePrint *out;
+static uint32_t segments = 0;
+static uint32_t records = 0;
+static uint32_t overflows = 0;
+static uint32_t rxSeq = 0;
+static uint32_t ackSeq = 0;
+static uint32_t burstLeft = 0;
+static uint32_t bursts = 0;
+
+static void ack(const uint8_t *frame, uint16_t len) {
+  (void) frame;
+  (void) len;
+  if (stack->frames % 2 == 0) {
+    stack->send(RECORD_ACK_LEN, ++ackSeq);
+  }
+}
+
+static void flush() {
+  if (trace.get_count() == 0)
+    return;
+  records += trace.write(*out);
+  overflows += trace.get_overflow_count();
+  trace.clear();
+  segments++;
+}
+
+static void flushPoll() {
+  if (trace.get_count() > ESPHostEMACConfig::trace_buffer_size / 2) {
+    flush();
+  }
+  HostSim::call_in_us(5000, mbed::callback(&flushPoll));
+}
+
+static void burstNext() {
+  if (burstLeft == 0) {
+    if (bursts == RECORD_BURSTS)
+      return;
+    bursts++;
+    burstLeft = 4 + lcg(21);
+    HostSim::call_in_us(20000 + lcg(280) * 1000, mbed::callback(&burstNext)); // idle gap
+    return;
+  }
+  uint8_t frame[HOST_FRAME_MAX];
+  uint16_t len = (lcg(4) == 0) ? 200 + lcg(1000) : HOST_FRAME_MAX;
+  HostFrame::build(frame, len, HOST_FRAME_ETH_IPV4, ++rxSeq, HostSim::now_us());
+  SimEsp::instance().air_rx(ESPHOST_STATION, frame, len);
+  burstLeft--;
+  HostSim::call_in_us(RECORD_FRAME_US, mbed::callback(&burstNext));
+}
+
+int main(int argc, char **argv) {
+  const char *path = (argc > 1) ? argv[1] : "build/trace.bin";
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) {
+    fprintf(stderr, "record: can't write %s\n", path);
+    return 1;
+  }
+  FilePrint file(f);
+  out = &file;
+
+  SimEsp &esp = SimEsp::instance();
+  esp.init_spi();
+  esp.start_warm("record");
+
+  HostMemoryManager memory;
+  HostStack s(memory);
+  stack = &s;
+  s.proc_us = 1000;
+  s.on_frame = mbed::callback(&ack);
+  SimEMAC &emac = SimEMAC::get_instance();
+  s.attach(emac);
+  SimEMAC::set_trace(&trace);
+  emac.power_up();
+  HostSim::run_for(100000);
+
+  trace.start();
+  flushPoll();
+  burstNext();
+  HostSim::run_until(mbed::Callback<bool()>([]() { return bursts == RECORD_BURSTS && burstLeft == 0; }), 60000000);
+  HostSim::run_for(500000);
+  trace.stop();
+  flush();
+  fclose(f);
+
+  SimEMAC::set_trace(NULL);
+  emac.power_down();
+  printf("record: %u frames received, %u sent, %u calls in %u segments to %s\n",
+      (unsigned) s.frames, (unsigned) esp.air_tx_frames, (unsigned) records, (unsigned) segments, path);
+  if (overflows) {
+    fprintf(stderr, "record: %u calls not recorded, the trace buffer was full\n", (unsigned) overflows);
+    return 1;
+  }
+  return 0;
+}
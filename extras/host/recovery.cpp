@@ -0,0 +1,153 @@
+// ESP recovery: a burst of sends which fills the TX queue of the ESP doesn't
+// reset it. Then the simulated ESP hangs while the station and the SoftAP run
+// with traffic. The watchdog resets it from the worker thread, the interfaces
+// are restored and only then their links come up. Only the probe in the
+// worker waits for the ESP with the mutex held, and sending fails fast
+// during the probe and the recovery.
+
+#include "HostTest.h"
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimEsp.h"
+#include "ESPHostEMACInterface.h"
+#include "WhdSoftAPInterface.h"
+
+static const uint64_t SECOND_US = 1000000;
+
+static void loopback(int iface, const uint8_t *data, uint16_t len) {
+  SimEsp::instance().air_rx(iface, data, len);
+}
+
+// the handler WiFi.beginAP of the Mbed Core registers, the SoftAP doesn't call it
+static void *softapEvent(whd_interface_t ifp, const whd_event_header_t *event_header, const uint8_t *event_data, void *handler_user_data) {
+  return NULL;
+}
+
+// a frame every 50 ms on the started interfaces, the time of the longest send is kept
+static HostStack *stacks[2];
+static bool started[2];
+static uint32_t txSeq = 0;
+static uint64_t maxSendUs = 0;
+static uint32_t linkDownFails = 0; // sends refused while the link is down
+
+static void sendNext() {
+  txSeq++;
+  for (unsigned i = 0; i < 2; i++) {
+    if (!started[i])
+      continue;
+    uint64_t start = HostSim::now_us();
+    bool linkUp = stacks[i]->link_up;
+    if (!stacks[i]->send(HOST_FRAME_MIN + 100, txSeq) && !linkUp) {
+      linkDownFails++;
+    }
+    if (HostSim::now_us() - start > maxSendUs) {
+      maxSendUs = HostSim::now_us() - start;
+    }
+  }
+  HostSim::call_in_us(50000, mbed::callback(&sendNext));
+}
+
+struct RecoveryResult {
+  bool recovered;
+  uint64_t linkDownUs;    // from the hang to the restored links
+  uint32_t failedSends;   // sends refused while the links were down
+};
+
+static RecoveryResult hangAndRecover(ESPHostEMACInterface &wifi, bool softapStarted) {
+  SimEsp &esp = SimEsp::instance();
+  HostStack &sta = *stacks[0];
+  HostStack &ap = *stacks[1];
+  uint32_t count = wifi.get_recovery_count();
+  uint32_t failed = linkDownFails;
+  uint64_t start = HostSim::now_us();
+  esp.hung = true;
+
+  RecoveryResult r;
+  HostSim::run_until(mbed::Callback<bool()>([&wifi, &sta, count]() {
+    return wifi.get_recovery_count() > count && sta.link_up;
+  }), 60 * SECOND_US);
+  r.recovered = wifi.get_recovery_count() == count + 1 && sta.link_up && (ap.link_up == softapStarted);
+  r.linkDownUs = HostSim::now_us() - start;
+  r.failedSends = linkDownFails - failed;
+
+  // the traffic runs again on the restored interfaces
+  uint32_t staFrames = sta.frames;
+  uint32_t apFrames = ap.frames;
+  HostSim::run_for(SECOND_US);
+  CHECK(sta.frames > staFrames);
+  CHECK((ap.frames > apFrames) == softapStarted);
+  return r;
+}
+
+int main() {
+  SimEsp &esp = SimEsp::instance();
+  esp.power_on();
+  esp.air_tx = mbed::callback(&loopback);
+
+  ESPHostEMACInterface wifi;
+  WhdSoftAPInterface softap;
+  CHECK(wifi.set_latency_profile(ESPHostEMACInterface::LATENCY_PROFILE_LOW_LATENCY) == NSAPI_ERROR_OK);
+  CHECK(wifi.connect("test", "password", NSAPI_SECURITY_WPA2) == NSAPI_ERROR_OK);
+  CHECK(softap.register_event_handler(&softapEvent) == NSAPI_ERROR_OK);
+  CHECK(softap.start("ap", "password", NSAPI_SECURITY_WPA2, 6) == NSAPI_ERROR_OK);
+  stacks[0] = &wifi.host_stack();
+  stacks[1] = &softap.host_stack();
+  stacks[0]->link_up = true;
+  stacks[1]->link_up = true;
+  started[0] = true;
+  started[1] = true;
+  sendNext();
+  HostSim::run_for(SECOND_US);
+  CHECK(stacks[0]->frames > 0 && stacks[1]->frames > 0);
+
+  // a send loop outruns the ESP for 200 ms, it refuses most of the sends
+  // but the probe finds it responding
+  uint32_t refused = esp.tx_refused;
+  uint64_t burstEnd = HostSim::now_us() + 200000;
+  for (uint32_t i = 0; HostSim::now_us() < burstEnd; i++) {
+    stacks[0]->send(HOST_FRAME_MIN + 100, i);
+    HostSim::sleep(20);
+  }
+  HostSim::run_for(SECOND_US);
+  printf("burst: %u sends refused, %u recoveries\n", (unsigned) (esp.tx_refused - refused),
+      (unsigned) wifi.get_recovery_count());
+  CHECK(esp.tx_refused - refused > ESPHostEMACConfig::health_tx_error_limit);
+  CHECK(wifi.get_recovery_count() == 0);
+  CHECK(esp.resets == 0);
+  uint32_t joins = esp.joins;
+  maxSendUs = 0;
+
+  // the SoftAP is restarted with the station
+  RecoveryResult both = hangAndRecover(wifi, true);
+  printf("hang with station and SoftAP: recovered %d in %u ms, last recovery %d ms, %u sends failed, longest send %u us\n",
+      both.recovered, (unsigned) (both.linkDownUs / 1000), (int) wifi.get_last_recovery_time().count(),
+      (unsigned) both.failedSends, (unsigned) maxSendUs);
+  CHECK(both.recovered);
+  CHECK(esp.resets == 1);
+  CHECK(esp.joins == joins + 1);
+  CHECK(esp.softap);
+  CHECK(esp.power_save == 0); // the latency profile is set again
+  CHECK(both.failedSends > 0);
+  CHECK(maxSendUs < 1000); // a send doesn't wait for the recovery
+  CHECK(stacks[0]->link_changes >= 2 && stacks[1]->link_changes >= 2);
+
+  // a stopped SoftAP stays down
+  CHECK(softap.stop() == NSAPI_ERROR_OK);
+  started[1] = false;
+  stacks[1]->link_up = false;
+  HostSim::run_for(SECOND_US);
+  RecoveryResult station = hangAndRecover(wifi, false);
+  printf("hang with station only: recovered %d in %u ms\n", station.recovered, (unsigned) (station.linkDownUs / 1000));
+  CHECK(station.recovered);
+  CHECK(esp.resets == 2);
+  CHECK(!esp.softap);
+
+  printf("waits with the mutex held: %u, longest %u us, %u of the probe in the worker\n", (unsigned) HostSim::blocked_with_lock,
+      (unsigned) HostSim::max_blocked_with_lock_us, (unsigned) HostSim::worker_blocked_with_lock);
+  CHECK(HostSim::blocked_with_lock == 0);
+  CHECK(HostSim::worker_blocked_with_lock == 2); // the probe of each hang
+
+  wifi.disconnect();
+  HostSim::run_for(SECOND_US);
+  return host_test_result("recovery");
+}
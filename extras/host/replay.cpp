@@ -0,0 +1,388 @@
+// Replays an ESPHost call trace recorded with ESPHostEMACTrace through the EMAC
+// of this tree over the simulated ESP, deterministically in virtual time.
+//
+//   replay [--heap BYTES] [--proc-us US] [--save REPORT] [--compare REPORT] TRACE
+//
+// The received frames of the trace arrive in the ESP by the communicateWithEsp
+// which moved them to ESPHost, with the Ethernet header of the trace. The stack
+// sends the frames of the trace at their recorded times. The report has the
+// throughput, the latency from the arrival in the ESP to the stack and the
+// allocations. --save writes it, --compare prints the differences to a saved
+// report and exits with 1 on a regression, so a report of one driver version
+// checks the next one.
+
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimTransport.h"
+#include "ESPHostEMAC_impl.h"
+#include "ESPHostEMACTrace.h"
+
+#include <stdlib.h>
+#include <vector>
+
+typedef ESPHostEMACBase<SimTransport> SimEMAC;
+
+struct Item {
+  uint64_t time;    // us from the start of the trace
+  bool rx;
+  uint8_t iface;
+  uint16_t len;
+  uint8_t header[HOST_FRAME_HEADER];
+  bool hasHeader;
+};
+
+struct TraceInfo {
+  uint32_t records;
+  uint32_t segments;
+  uint32_t version;
+  uint32_t allocs;
+  uint32_t allocFailures;
+  uint64_t duration;
+};
+
+static uint32_t get32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t get16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+// reads the segments of the trace into the frames to replay
+static bool readTrace(const char *path, std::vector<Item> &items, TraceInfo &info) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "replay: can't read %s\n", path);
+    return false;
+  }
+  memset(&info, 0, sizeof(info));
+  bool first = true;
+  uint32_t last = 0;
+  uint64_t now = 0;
+  uint64_t communicated = 0;
+  uint8_t header[12];
+  while (fread(header, 1, sizeof(header), f) == sizeof(header)) {
+    uint16_t version = get16(header + 4);
+    uint16_t size = get16(header + 6);
+    uint32_t count = get32(header + 8);
+    if (memcmp(header, "ESPT", 4) != 0 || version < 1 || version > 2 || size < 10 || size > 255) {
+      fprintf(stderr, "replay: %s is not a trace of version 1 or 2\n", path);
+      fclose(f);
+      return false;
+    }
+    info.version = version;
+    info.segments++;
+    for (uint32_t i = 0; i < count; i++) {
+      uint8_t r[255];
+      if (fread(r, 1, size, f) != size) {
+        fprintf(stderr, "replay: %s is truncated\n", path);
+        fclose(f);
+        return false;
+      }
+      uint32_t start = get32(r);
+      if (!first) {
+        now += (uint32_t) (start - last);
+      }
+      first = false;
+      last = start;
+      info.records++;
+      uint16_t len = get16(r + 6);
+      uint8_t call = r[8] & 0x0f;
+      uint8_t iface = r[8] >> 4;
+      int8_t result = (int8_t) r[9];
+      if (call == ESPHostEMACTrace::COMMUNICATE) {
+        communicated = now;
+      } else if (call == ESPHostEMACTrace::ALLOC) {
+        info.allocs++;
+        if (result != 0) {
+          info.allocFailures++;
+        }
+      } else if ((call == ESPHostEMACTrace::GET_RX || call == ESPHostEMACTrace::SEND) && len && iface < ESPHOST_INTERFACE_COUNT) {
+        Item item;
+        item.rx = (call == ESPHostEMACTrace::GET_RX);
+        item.time = item.rx ? communicated : now;
+        item.iface = iface;
+        item.len = (len > HOST_FRAME_MAX) ? HOST_FRAME_MAX : len;
+        item.hasHeader = (size - 10 >= HOST_FRAME_HEADER && len >= HOST_FRAME_HEADER);
+        memcpy(item.header, r + 10, item.hasHeader ? HOST_FRAME_HEADER : 0);
+        items.push_back(item);
+      }
+    }
+  }
+  fclose(f);
+  info.duration = now;
+  if (info.segments == 0) {
+    fprintf(stderr, "replay: %s is empty\n", path);
+    return false;
+  }
+  return true;
+}
+
+// the metrics of a report, a regression is a change to the worse over the tolerance
+struct Metric {
+  const char *name;
+  int worse;          // 1 higher is worse, -1 lower is worse, 0 for information
+  double tolerance;   // relative
+  double slack;       // absolute
+  double value;
+};
+
+enum {
+  M_RX_FRAMES, M_TX_FRAMES, M_THROUGHPUT, M_LATENCY_AVG, M_LATENCY_P99, M_LATENCY_MAX, M_DRAIN,
+  M_ESP_RX_DROPS, M_TX_ERRORS, M_ALLOCS, M_ALLOC_FAILURES, M_DATAPATH_HEAP_ALLOCS, M_RX_PAUSES, M_WAKEUPS,
+  M_COUNT
+};
+
+static Metric metrics[M_COUNT] = {
+  {"rx_frames", -1, 0, 0, 0},
+  {"tx_frames", -1, 0, 0, 0},
+  {"throughput_kbps", -1, 0.02, 0, 0},
+  {"latency_avg_us", 1, 0.1, 100, 0},
+  {"latency_p99_us", 1, 0.1, 100, 0},
+  {"latency_max_us", 0, 0, 0, 0},
+  {"drain_us", 1, 0.1, 1000, 0},
+  {"esp_rx_drops", 1, 0, 0, 0},
+  {"tx_errors", 1, 0, 0, 0},
+  {"allocs", 1, 0.02, 0, 0},
+  {"alloc_failures", 1, 0, 0, 0},
+  {"datapath_heap_allocs", 1, 0, 0, 0},
+  {"rx_pauses", 0, 0, 0, 0},
+  {"wakeups", 0, 0, 0, 0}
+};
+
+static std::vector<Item> items;
+static size_t next = 0;
+static uint64_t start = 0;
+static uint64_t lastFrame = 0;
+static uint32_t seq = 0;
+static uint32_t txAllocs = 0;
+static HostMemoryManager *memory;
+static HostStack *stacks[ESPHOST_INTERFACE_COUNT];
+static SimEMAC *emacs[ESPHOST_INTERFACE_COUNT];
+
+static void frameProcessed(const uint8_t *frame, uint16_t len) {
+  (void) frame;
+  (void) len;
+  lastFrame = HostSim::now_us();
+}
+
+static void buildFrame(uint8_t *frame, const Item &item) {
+  uint16_t ethertype = item.hasHeader ? HostFrame::ethertype(item.header) : HOST_FRAME_ETH_IPV4;
+  HostFrame::build(frame, item.len, ethertype, ++seq, HostSim::now_us());
+  if (item.hasHeader) {
+    memcpy(frame, item.header, HOST_FRAME_HEADER);
+  }
+}
+
+static void replayNext() {
+  uint64_t now = HostSim::now_us() - start;
+  while (next < items.size() && items[next].time <= now) {
+    const Item &item = items[next++];
+    uint8_t frame[HOST_FRAME_MAX];
+    buildFrame(frame, item);
+    if (item.rx) {
+      SimEsp::instance().air_rx(item.iface, frame, item.len);
+    } else if (emacs[item.iface]) {
+      emac_mem_buf_t *buf = memory->alloc_frame(item.len);
+      if (buf == NULL) {
+        stacks[item.iface]->tx_nomem++;
+        continue;
+      }
+      txAllocs++;
+      memory->copy_to_buf(buf, frame, item.len);
+      if (!emacs[item.iface]->link_out(buf)) {
+        stacks[item.iface]->tx_failed++;
+      }
+    }
+  }
+  if (next < items.size()) {
+    HostSim::call_in_us(items[next].time - now, mbed::callback(&replayNext));
+  }
+}
+
+static bool replayDone() {
+  return next == items.size();
+}
+
+static bool readReport(const char *path, double *values) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    fprintf(stderr, "replay: can't read %s\n", path);
+    return false;
+  }
+  for (unsigned i = 0; i < M_COUNT; i++) {
+    values[i] = -1;
+  }
+  char name[64];
+  double value;
+  while (fscanf(f, "%63s %lf", name, &value) == 2) {
+    for (unsigned i = 0; i < M_COUNT; i++) {
+      if (strcmp(name, metrics[i].name) == 0) {
+        values[i] = value;
+      }
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static void usage() {
+  fprintf(stderr, "usage: replay [--heap BYTES] [--proc-us US] [--save REPORT] [--compare REPORT] TRACE\n");
+}
+
+int main(int argc, char **argv) {
+  uint32_t heap = 64 * 1024;
+  uint32_t procUs = 0;
+  const char *savePath = NULL;
+  const char *comparePath = NULL;
+  const char *tracePath = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--heap") == 0 && i + 1 < argc) {
+      heap = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--proc-us") == 0 && i + 1 < argc) {
+      procUs = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+      savePath = argv[++i];
+    } else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+      comparePath = argv[++i];
+    } else if (argv[i][0] != '-' && tracePath == NULL) {
+      tracePath = argv[i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (tracePath == NULL) {
+    usage();
+    return 2;
+  }
+
+  TraceInfo info;
+  if (!readTrace(tracePath, items, info))
+    return 2;
+  unsigned traceRx = 0;
+  for (size_t i = 0; i < items.size(); i++) {
+    traceRx += items[i].rx;
+  }
+  printf("%s: version %u, %u calls in %u segments over %u ms, %u frames received, %u sent, %u of %u allocations failed\n",
+      tracePath, (unsigned) info.version, (unsigned) info.records, (unsigned) info.segments, (unsigned) (info.duration / 1000),
+      traceRx, (unsigned) (items.size() - traceRx), (unsigned) info.allocFailures, (unsigned) info.allocs);
+
+  SimEsp &esp = SimEsp::instance();
+  esp.init_spi();
+  esp.start_warm("replay");
+  HostMemoryManager mem(heap);
+  memory = &mem;
+  HostStack station(mem);
+  HostStack softap(mem);
+  stacks[ESPHOST_STATION] = &station;
+  stacks[ESPHOST_SOFT_AP] = &softap;
+  for (size_t i = 0; i < items.size(); i++) {
+    uint8_t iface = items[i].iface;
+    if (emacs[iface] == NULL) {
+      emacs[iface] = (iface == ESPHOST_STATION) ? &SimEMAC::get_instance() : &SimEMAC::get_softap_instance();
+      stacks[iface]->proc_us = procUs;
+      stacks[iface]->on_frame = mbed::callback(&frameProcessed);
+      stacks[iface]->attach(*emacs[iface]);
+      emacs[iface]->power_up();
+    }
+  }
+  HostSim::run_for(100000);
+
+  uint32_t airTx = esp.air_tx_frames;
+  uint32_t espRxDrops = esp.esp_rx_drops;
+  uint32_t datapathHeapAllocs = SimEMAC::get_datapath_heap_allocs();
+  start = HostSim::now_us();
+  replayNext();
+  HostSim::run_until(mbed::Callback<bool()>(&replayDone), info.duration + 1000000);
+  uint64_t replayed = HostSim::now_us();
+  HostSim::run_for(2000000); // the backlog drains
+
+  HostLatency latency;
+  uint32_t rxFrames = 0;
+  uint64_t bytes = 0;
+  uint32_t txErrors = 0;
+  uint32_t rxPauses = 0;
+  for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+    if (emacs[i] == NULL)
+      continue;
+    ESPHostEMACStats stats;
+    emacs[i]->get_stats(stats);
+    HostStack &s = *stacks[i];
+    rxFrames += s.frames;
+    bytes += s.bytes + stats.tx_bytes;
+    txErrors += stats.tx_errors + s.tx_nomem;
+    rxPauses += stats.rx_pauses;
+    for (unsigned b = 0; b < HOST_LATENCY_BUCKETS; b++) {
+      latency.histogram[b] += s.latency.histogram[b];
+    }
+    latency.count += s.latency.count;
+    latency.sum += s.latency.sum;
+    if (s.latency.max > latency.max) {
+      latency.max = s.latency.max;
+    }
+  }
+  uint64_t end = (lastFrame > replayed) ? lastFrame : replayed;
+  double seconds = (end - start) / 1e6;
+
+  metrics[M_RX_FRAMES].value = rxFrames;
+  metrics[M_TX_FRAMES].value = esp.air_tx_frames - airTx;
+  metrics[M_THROUGHPUT].value = (seconds > 0) ? (uint64_t) (bytes * 8 / seconds / 1000) : 0;
+  metrics[M_LATENCY_AVG].value = latency.avg();
+  metrics[M_LATENCY_P99].value = latency.percentile(99);
+  metrics[M_LATENCY_MAX].value = latency.max;
+  metrics[M_DRAIN].value = (lastFrame > replayed) ? lastFrame - replayed : 0;
+  metrics[M_ESP_RX_DROPS].value = esp.esp_rx_drops - espRxDrops;
+  metrics[M_TX_ERRORS].value = txErrors;
+  metrics[M_ALLOCS].value = mem.heap_allocs + mem.pool_allocs - txAllocs; // of the EMAC
+  metrics[M_ALLOC_FAILURES].value = mem.heap_failures + mem.pool_failures;
+  metrics[M_DATAPATH_HEAP_ALLOCS].value = SimEMAC::get_datapath_heap_allocs() - datapathHeapAllocs;
+  metrics[M_RX_PAUSES].value = rxPauses;
+  metrics[M_WAKEUPS].value = SimEMAC::get_wakeup_count();
+
+  for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+    if (emacs[i]) {
+      emacs[i]->power_down();
+    }
+  }
+
+  double baseline[M_COUNT];
+  bool compare = (comparePath != NULL);
+  if (compare && !readReport(comparePath, baseline))
+    return 2;
+  unsigned regressions = 0;
+  for (unsigned i = 0; i < M_COUNT; i++) {
+    const Metric &m = metrics[i];
+    if (!compare) {
+      printf("%-22s %12.0f\n", m.name, m.value);
+      continue;
+    }
+    double base = baseline[i];
+    if (base < 0) {
+      printf("%-22s %12s %12.0f\n", m.name, "-", m.value);
+      continue;
+    }
+    double diff = m.value - base;
+    double limit = base * m.tolerance + m.slack;
+    bool regression = (m.worse > 0 && diff > limit) || (m.worse < 0 && -diff > limit);
+    regressions += regression;
+    printf("%-22s %12.0f %12.0f %+8.1f%%%s\n", m.name, base, m.value, base ? diff * 100 / base : 0.0,
+        regression ? "  REGRESSION" : "");
+  }
+
+  if (savePath) {
+    FILE *f = fopen(savePath, "w");
+    if (f == NULL) {
+      fprintf(stderr, "replay: can't write %s\n", savePath);
+      return 2;
+    }
+    for (unsigned i = 0; i < M_COUNT; i++) {
+      fprintf(f, "%s %.0f\n", metrics[i].name, metrics[i].value);
+    }
+    fclose(f);
+  }
+  if (compare) {
+    printf("replay: %u regressions against %s\n", regressions, comparePath);
+  }
+  return regressions ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+// Static allocation mode: frames in both directions, aligned, unaligned and
+// chained, take no buffer from the heap of the memory manager while the
+// simulated ESPHost queues allocate for every frame. The datapath count of the
+// EMAC matches the buffers it took from the heap, in both modes, and the RAM
+// footprint counts only the created EMACs. A scan finding more than MAX_AP_COUNT access
+// points returns the first MAX_AP_COUNT.
+
+#include "HostTest.h"
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimTransport.h"
+#include "ESPHostEMAC_impl.h"
+#include "ESPHostEMACInterface.h"
+
+struct StaticConfig : ESPHostEMACConfig {
+  static constexpr bool static_alloc = true;
+};
+
+static const uint32_t FRAME_COUNT = 300;
+static const uint16_t FRAME_LEN = 1000;
+
+static void loopback(int iface, const uint8_t *data, uint16_t len) {
+  SimEsp::instance().air_rx(iface, data, len);
+}
+
+template<class EMAC>
+static void run(const char *name, bool staticAlloc) {
+  EMAC &emac = EMAC::get_instance();
+  HostMemoryManager memory;
+  HostStack stack(memory);
+  stack.attach(emac);
+  emac.power_up();
+  HostSim::run_for(100000);
+
+  uint32_t heapBuffers = memory.heap_allocs;
+  uint32_t stackBuffers = 0; // the frames HostStack sends
+  uint32_t heapAllocs = HostSim::heap_allocs();
+  for (uint32_t i = 1; i <= FRAME_COUNT; i++) {
+    bool unaligned = (i % 3 == 1);
+    bool chained = (i % 3 == 2);
+    stack.send(FRAME_LEN, i, HOST_FRAME_ETH_IPV4, unaligned, chained);
+    stackBuffers += chained ? 2 : 1;
+    HostSim::sleep(6000);
+  }
+  bool done = HostSim::run_until(mbed::Callback<bool()>([&stack]() { return stack.frames == FRAME_COUNT; }), 10000000);
+  uint32_t emacBuffers = memory.heap_allocs - heapBuffers - stackBuffers;
+  uint32_t allocs = HostSim::heap_allocs() - heapAllocs;
+
+  printf("%s: %u frames looped back, %u heap buffers of the EMAC, %u pool buffers, %u heap allocations, %u on the datapath\n",
+      name, (unsigned) stack.frames, (unsigned) emacBuffers, (unsigned) memory.pool_allocs, (unsigned) allocs,
+      (unsigned) emac.get_datapath_heap_allocs());
+  CHECK(done);
+  CHECK(stack.bad_frames == 0);
+  CHECK(stack.tx_failed == 0);
+  CHECK(allocs > 0); // of the ESPHost queues
+  CHECK(emac.get_datapath_heap_allocs() == emacBuffers);
+  if (staticAlloc) {
+    CHECK(emacBuffers == 0);
+    CHECK(memory.pool_allocs >= FRAME_COUNT);
+  } else {
+    CHECK(emacBuffers > 0);
+  }
+  CHECK(memory.heap_used == 0);
+  CHECK(memory.pool_used == 0);
+
+  emac.power_down();
+  HostSim::run_for(100000);
+
+  size_t footprint = EMAC::get_ram_footprint();
+  EMAC::get_softap_instance();
+  printf("%s: RAM footprint %u bytes, %u with the SoftAP EMAC\n", name, (unsigned) footprint,
+      (unsigned) EMAC::get_ram_footprint());
+  CHECK(footprint > sizeof(EMAC) + StaticConfig::worker_stack_size);
+  CHECK(EMAC::get_ram_footprint() == footprint + sizeof(EMAC));
+}
+
+int main() {
+  SimEsp &esp = SimEsp::instance();
+  esp.init_spi();
+  esp.start_warm("test");
+  esp.air_tx = mbed::callback(&loopback);
+
+  run<ESPHostEMACBase<SimTransport, StaticConfig> >("static", true);
+  run<ESPHostEMACBase<SimTransport> >("heap", false);
+
+  esp.params.scan_results = MAX_AP_COUNT + 5;
+  ESPHostEMACInterface wifi;
+  WiFiAccessPoint res[MAX_AP_COUNT + 5];
+  CHECK(wifi.scan(NULL, 0) == MAX_AP_COUNT);
+  int found = wifi.scan(res, MAX_AP_COUNT + 5);
+  printf("scan: %u access points found, %d returned\n", (unsigned) esp.params.scan_results, found);
+  CHECK(found == MAX_AP_COUNT);
+  CHECK(strcmp(res[MAX_AP_COUNT - 1].get_ssid(), "ap9") == 0);
+  CHECK(wifi.scan(res, 3) == 3);
+
+  return host_test_result("static_alloc");
+}
@@ -0,0 +1,152 @@
+// host stub of the Arduino API used by the library, the benchmark and the tests
+
+#ifndef HOST_STUB_ARDUINO_H_
+#define HOST_STUB_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include "HostSim.h"
+
+#define DEC 10
+#define HEX 16
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+namespace arduino {
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      n += write(*buffer++);
+    }
+    return n;
+  }
+
+  size_t write(const char *str) {
+    return write((const uint8_t*) str, strlen(str));
+  }
+
+  size_t print(const char *str) {
+    return write(str);
+  }
+
+  size_t print(char c) {
+    return write((uint8_t) c);
+  }
+
+  size_t print(int n, int base = DEC) {
+    return print((long) n, base);
+  }
+
+  size_t print(unsigned n, int base = DEC) {
+    return print((unsigned long) n, base);
+  }
+
+  size_t print(long n, int base = DEC) {
+    char buff[24];
+    snprintf(buff, sizeof(buff), (base == HEX) ? "%lx" : "%ld", n);
+    return print(buff);
+  }
+
+  size_t print(unsigned long n, int base = DEC) {
+    char buff[24];
+    snprintf(buff, sizeof(buff), (base == HEX) ? "%lx" : "%lu", n);
+    return print(buff);
+  }
+
+  size_t print(double n, int digits = 2) {
+    char buff[32];
+    snprintf(buff, sizeof(buff), "%.*f", digits, n);
+    return print(buff);
+  }
+
+  size_t println() {
+    return print("\r\n");
+  }
+
+  template<typename T>
+  size_t println(T v) {
+    size_t n = print(v);
+    return n + println();
+  }
+
+  template<typename T>
+  size_t println(T v, int format) {
+    size_t n = print(v, format);
+    return n + println();
+  }
+};
+
+}
+
+using arduino::Print;
+
+/** IPAddress of the host build, the host sockets don't route */
+class IPAddress {
+public:
+  IPAddress() : bytes{0, 0, 0, 0} {}
+  IPAddress(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) : bytes{b1, b2, b3, b4} {}
+  uint8_t operator[](int index) const {
+    return bytes[index];
+  }
+private:
+  uint8_t bytes[4];
+};
+
+/** Serial of the host build writes to stdout */
+class HostSerial : public arduino::Print {
+public:
+  void begin(unsigned long baud) {
+    (void) baud;
+  }
+  explicit operator bool() const {
+    return true;
+  }
+  int available() {
+    return 0;
+  }
+  int read() {
+    return -1;
+  }
+  size_t write(uint8_t b) {
+    return (b == '\r') ? 1 : fwrite(&b, 1, 1, stdout);
+  }
+  using arduino::Print::write;
+};
+
+extern HostSerial Serial;
+
+inline void delay(unsigned long ms) {
+  HostSim::sleep((uint64_t) ms * 1000);
+}
+
+inline unsigned long millis() {
+  return HostSim::now_us() / 1000;
+}
+
+inline unsigned long micros() {
+  return HostSim::now_us();
+}
+
+inline void pinMode(int pin, int mode) {
+  (void) pin;
+  (void) mode;
+}
+
+inline void digitalWrite(int pin, int value) {
+  if (HostSim::digital_write) {
+    HostSim::digital_write(pin, value);
+  }
+}
+
+#endif
@@ -0,0 +1,59 @@
+// host stub of the ESPHost control message types
+
+#ifndef HOST_STUB_CCTRLWRAPPER_H_
+#define HOST_STUB_CCTRLWRAPPER_H_
+
+#include <stdint.h>
+
+struct CCtrlMsgWrapper {
+};
+
+enum {
+  WIFI_AUTH_OPEN,
+  WIFI_AUTH_WEP,
+  WIFI_AUTH_WPA_PSK,
+  WIFI_AUTH_WPA2_PSK,
+  WIFI_AUTH_WPA_WPA2_PSK,
+  WIFI_AUTH_WPA2_ENTERPRISE,
+  WIFI_AUTH_WPA3_PSK,
+  WIFI_AUTH_WPA2_WPA3_PSK
+};
+
+enum {
+  WIFI_BW_HT20 = 1,
+  WIFI_BW_HT40
+};
+
+struct WifiApCfg_t {
+  uint8_t ssid[33];
+  uint8_t pwd[64];
+  uint8_t bssid[18];
+  bool is_wpa3_supported;
+  int rssi;
+  int channel;
+  int encryption_mode;
+  uint16_t listen_interval;
+  char status[32];
+  char out_mac[18];
+};
+
+struct SoftApCfg_t {
+  uint8_t ssid[33];
+  uint8_t pwd[64];
+  int channel;
+  int encryption_mode;
+  int max_connections;
+  bool ssid_hidden;
+  int bandwidth;
+  char out_mac[18];
+};
+
+struct AccessPoint_t {
+  uint8_t ssid[33];
+  uint8_t bssid[18];
+  int rssi;
+  int channel;
+  int encryption_mode;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "CEspControl.h"
+#include "SimEsp.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static EspCallback_f initCb = NULL;
+
+static void initEvent() {
+  CCtrlMsgWrapper msg;
+  if (initCb) {
+    initCb(&msg);
+  }
+}
+
+void CNetUtilities::macStr2macArray(uint8_t *mac_out, const char *mac_in) {
+  unsigned b[6] = {0};
+  sscanf(mac_in, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]);
+  for (unsigned i = 0; i < 6; i++) {
+    mac_out[i] = b[i];
+  }
+}
+
+CEspControl& CEspControl::getInstance() {
+  static CEspControl instance;
+  return instance;
+}
+
+int CEspControl::initSpiDriver() {
+  SimEsp::instance().init_spi();
+  return 0;
+}
+
+int CEspControl::listenForInitEvent(EspCallback_f cb) {
+  initCb = cb;
+  SimEsp::instance().init_event = mbed::callback(&initEvent);
+  return ESP_CONTROL_OK;
+}
+
+void CEspControl::listenForStationDisconnectEvent(EspCallback_f cb) {
+  (void) cb;
+}
+
+void CEspControl::communicateWithEsp() {
+  SimEsp::instance().communicate();
+}
+
+uint16_t CEspControl::peekStationRxMsgSize() {
+  return SimEsp::instance().peek_rx(0);
+}
+
+uint16_t CEspControl::peekSoftApRxMsgSize() {
+  return SimEsp::instance().peek_rx(1);
+}
+
+uint8_t* CEspControl::getStationRx(uint8_t &if_num, uint8_t *buffer, uint16_t dim) {
+  if_num = 0;
+  SimEsp::instance().get_rx(0, buffer, dim);
+  return buffer;
+}
+
+uint8_t* CEspControl::getSoftApRx(uint8_t &if_num, uint8_t *buffer, uint16_t dim) {
+  if_num = 1;
+  SimEsp::instance().get_rx(1, buffer, dim);
+  return buffer;
+}
+
+int CEspControl::sendBuffer(ESP_INTERFACE_TYPE type, uint8_t num, uint8_t *buf, uint16_t dim) {
+  (void) num;
+  return SimEsp::instance().send((type == ESP_AP_IF) ? 1 : 0, buf, dim);
+}
+
+int CEspControl::getWifiMacAddress(WifiMac_t &mac) {
+  SimEsp &esp = SimEsp::instance();
+  if (!esp.control(esp.params.control_ms))
+    return ESP_CONTROL_ERROR;
+  snprintf(mac.mac, sizeof(mac.mac), "%02x:%02x:%02x:%02x:%02x:%02x", esp.mac[0], esp.mac[1], esp.mac[2], esp.mac[3], esp.mac[4],
+      (uint8_t) (esp.mac[5] + (mac.mode == WIFI_MODE_AP)));
+  return ESP_CONTROL_OK;
+}
+
+int CEspControl::connectAccessPoint(WifiApCfg_t &ap_info) {
+  SimEsp &esp = SimEsp::instance();
+  if (!esp.control(esp.params.join_ms))
+    return ESP_CONTROL_ERROR;
+  esp.joins++;
+  esp.associated = true;
+  memset(esp.ssid, 0, sizeof(esp.ssid));
+  memcpy(esp.ssid, ap_info.ssid, sizeof(esp.ssid) - 1);
+  return ESP_CONTROL_OK;
+}
+
+int CEspControl::getAccessPointConfig(WifiApCfg_t &ap) {
+  SimEsp &esp = SimEsp::instance();
+  if (!esp.control(esp.params.control_ms) || !esp.associated)
+    return ESP_CONTROL_ERROR;
+  memset(&ap, 0, sizeof(ap));
+  memcpy(ap.ssid, esp.ssid, sizeof(ap.ssid));
+  strcpy((char*) ap.bssid, "02:00:00:00:00:01");
+  ap.rssi = -50;
+  ap.channel = 6;
+  ap.encryption_mode = WIFI_AUTH_WPA2_PSK;
+  return ESP_CONTROL_OK;
+}
+
+int CEspControl::disconnectAccessPoint() {
+  SimEsp &esp = SimEsp::instance();
+  if (!esp.control(esp.params.control_ms))
+    return ESP_CONTROL_ERROR;
+  esp.associated = false;
+  return ESP_CONTROL_OK;
+}
+
+int CEspControl::getAccessPointScanList(std::vector<AccessPoint_t> &l) {
+  SimEsp &esp = SimEsp::instance();
+  if (!esp.control(esp.params.scan_ms))
+    return ESP_CONTROL_ERROR;
+  for (uint32_t i = 0; i < esp.params.scan_results; i++) { // ESPHost appends all found access points
+    AccessPoint_t ap;
+    memset(&ap, 0, sizeof(ap));
+    snprintf((char*) ap.ssid, sizeof(ap.ssid), "ap%u", (unsigned) i);
+    snprintf((char*) ap.bssid, sizeof(ap.bssid), "02:00:00:00:01:%02x", (unsigned) (i & 0xff));
+    ap.rssi = -40 - (int) i;
+    ap.channel = 1 + i % 11;
+    ap.encryption_mode = WIFI_AUTH_WPA2_PSK;
+    l.push_back(ap);
+  }
+  return ESP_CONTROL_OK;
+}
+
+int CEspControl::setPowerSaveMode(int power_save_mode) {
+  SimEsp &esp = SimEsp::instance();
+  if (!esp.control(esp.params.control_ms))
+    return ESP_CONTROL_ERROR;
+  esp.power_save = power_save_mode;
+  esp.power_save_sets++;
+  return ESP_CONTROL_OK;
+}
+
+int CEspControl::startSoftAccessPoint(SoftApCfg_t &cfg) {
+  (void) cfg;
+  SimEsp &esp = SimEsp::instance();
+  if (!esp.control(esp.params.control_ms))
+    return ESP_CONTROL_ERROR;
+  esp.softap = true;
+  return ESP_CONTROL_OK;
+}
+
+int CEspControl::stopSoftAccessPoint() {
+  SimEsp &esp = SimEsp::instance();
+  if (!esp.control(esp.params.control_ms))
+    return ESP_CONTROL_ERROR;
+  esp.softap = false;
+  return ESP_CONTROL_OK;
+}
@@ -0,0 +1,60 @@
+// host stub of the ESPHost control API, backed by SimEsp
+
+#ifndef HOST_STUB_CESPCONTROL_H_
+#define HOST_STUB_CESPCONTROL_H_
+
+#include <stdint.h>
+#include <vector>
+#include "Arduino.h"
+#include "CCtrlWrapper.h"
+
+#define ESP_CONTROL_OK     0
+#define ESP_CONTROL_ERROR -1
+
+enum ESP_INTERFACE_TYPE {
+  ESP_STA_IF,
+  ESP_AP_IF
+};
+
+enum {
+  WIFI_MODE_STA = 1,
+  WIFI_MODE_AP = 2
+};
+
+struct WifiMac_t {
+  int mode;
+  char mac[18];
+};
+
+struct CNetUtilities {
+  static void macStr2macArray(uint8_t *mac_out, const char *mac_in);
+};
+
+typedef int (*EspCallback_f)(CCtrlMsgWrapper *resp);
+
+class CEspControl {
+public:
+  static CEspControl& getInstance();
+
+  int initSpiDriver();
+  int listenForInitEvent(EspCallback_f cb);
+  void listenForStationDisconnectEvent(EspCallback_f cb);
+  void communicateWithEsp();
+
+  uint16_t peekStationRxMsgSize();
+  uint16_t peekSoftApRxMsgSize();
+  uint8_t* getStationRx(uint8_t &if_num, uint8_t *buffer, uint16_t dim);
+  uint8_t* getSoftApRx(uint8_t &if_num, uint8_t *buffer, uint16_t dim);
+  int sendBuffer(ESP_INTERFACE_TYPE type, uint8_t num, uint8_t *buf, uint16_t dim);
+
+  int getWifiMacAddress(WifiMac_t &mac);
+  int connectAccessPoint(WifiApCfg_t &ap_info);
+  int getAccessPointConfig(WifiApCfg_t &ap);
+  int disconnectAccessPoint();
+  int getAccessPointScanList(std::vector<AccessPoint_t> &l);
+  int setPowerSaveMode(int power_save_mode);
+  int startSoftAccessPoint(SoftApCfg_t &cfg);
+  int stopSoftAccessPoint();
+};
+
+#endif
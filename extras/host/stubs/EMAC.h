@@ -0,0 +1,53 @@
+// host stub of the Mbed OS EMAC API
+
+#ifndef HOST_STUB_EMAC_H_
+#define HOST_STUB_EMAC_H_
+
+#include <stdint.h>
+#include "platform/Callback.h"
+
+typedef void emac_mem_buf_t;
+typedef void net_stack_mem_buf_t;
+
+typedef mbed::Callback<void(emac_mem_buf_t *buf)> emac_link_input_cb_t;
+typedef mbed::Callback<void(bool up)> emac_link_state_change_cb_t;
+
+class EMACMemoryManager {
+public:
+  virtual ~EMACMemoryManager() {}
+  virtual emac_mem_buf_t* alloc_heap(uint32_t size, uint32_t align) = 0;
+  virtual emac_mem_buf_t* alloc_pool(uint32_t size, uint32_t align) = 0;
+  virtual uint32_t get_pool_alloc_unit(uint32_t align) const = 0;
+  virtual void free(emac_mem_buf_t *buf) = 0;
+  virtual uint32_t get_total_len(const emac_mem_buf_t *buf) const = 0;
+  virtual void copy(emac_mem_buf_t *to_buf, const emac_mem_buf_t *from_buf) = 0;
+  virtual void copy_to_buf(emac_mem_buf_t *to_buf, const void *ptr, uint32_t len) = 0;
+  virtual uint32_t copy_from_buf(void *ptr, uint32_t len, const emac_mem_buf_t *from_buf) const = 0;
+  virtual void cat(emac_mem_buf_t *to_buf, emac_mem_buf_t *cat_buf) = 0;
+  virtual emac_mem_buf_t* get_next(const emac_mem_buf_t *buf) const = 0;
+  virtual void* get_ptr(const emac_mem_buf_t *buf) const = 0;
+  virtual uint32_t get_len(const emac_mem_buf_t *buf) const = 0;
+  virtual void set_len(emac_mem_buf_t *buf, uint32_t len) = 0;
+};
+
+class EMAC {
+public:
+  virtual ~EMAC() {}
+  virtual bool power_up() = 0;
+  virtual void power_down() = 0;
+  virtual uint32_t get_mtu_size() const = 0;
+  virtual uint32_t get_align_preference() const = 0;
+  virtual void get_ifname(char *name, uint8_t size) const = 0;
+  virtual uint8_t get_hwaddr_size() const = 0;
+  virtual bool get_hwaddr(uint8_t *addr) const = 0;
+  virtual void set_hwaddr(const uint8_t *addr) = 0;
+  virtual bool link_out(emac_mem_buf_t *buf) = 0;
+  virtual void set_link_input_cb(emac_link_input_cb_t input_cb) = 0;
+  virtual void set_link_state_cb(emac_link_state_change_cb_t state_cb) = 0;
+  virtual void add_multicast_group(const uint8_t *address) = 0;
+  virtual void remove_multicast_group(const uint8_t *address) = 0;
+  virtual void set_all_multicast(bool all) = 0;
+  virtual void set_memory_manager(EMACMemoryManager &mem_mngr) = 0;
+};
+
+#endif
@@ -0,0 +1,88 @@
+// host stub of the Mbed OS API used by the library
+
+#ifndef HOST_STUB_MBED_H_
+#define HOST_STUB_MBED_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "platform/Callback.h"
+#include "HostSim.h"
+#include "mbed_events.h"
+
+typedef void* osSemaphoreId_t;
+
+#define DEVICE_RESET_REASON 1
+#define DEVICE_LPTICKER 1
+
+typedef enum {
+  RESET_REASON_POWER_ON,
+  RESET_REASON_PIN_RESET,
+  RESET_REASON_SOFTWARE,
+  RESET_REASON_WATCHDOG,
+  RESET_REASON_UNKNOWN
+} reset_reason_t;
+
+struct ticker_data_t;
+
+inline uint32_t us_ticker_read() {
+  return (uint32_t) HostSim::now_us();
+}
+
+inline const ticker_data_t* get_us_ticker_data() {
+  return nullptr;
+}
+
+inline uint64_t ticker_read_us(const ticker_data_t*) {
+  return HostSim::now_us();
+}
+
+inline void wait_us(int us) {
+  HostSim::busy(us);
+}
+
+namespace mbed {
+
+/** The reset reason of the MCU, set by SimEsp: power_on powers on the MCU with
+ *  the ESP, start_warm resets the MCU alone */
+class ResetReason {
+public:
+  static reset_reason_t get() {
+    return host_reason();
+  }
+  static reset_reason_t& host_reason() {
+    static reset_reason_t reason = RESET_REASON_POWER_ON;
+    return reason;
+  }
+};
+
+/** The data-ready line of SimEsp, whatever the pin. SimEsp samples the line
+ *  itself and calls the ticker only while it is high. */
+class DigitalIn {
+public:
+  explicit DigitalIn(int pin) {
+    (void) pin;
+  }
+  int read() {
+    return 1;
+  }
+};
+
+/** The sampling of the data-ready line by SimEsp */
+class LowPowerTicker {
+public:
+  void attach(Callback<void()> func, std::chrono::microseconds t) {
+    HostSim::data_ready = func;
+    HostSim::data_ready_period_us = t.count();
+  }
+  void detach() {
+    HostSim::data_ready = nullptr;
+  }
+};
+
+}
+
+#endif
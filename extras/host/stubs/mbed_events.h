@@ -0,0 +1,59 @@
+// host stub of the Mbed OS event queue, the events run in HostSim
+
+#ifndef HOST_STUB_MBED_EVENTS_H_
+#define HOST_STUB_MBED_EVENTS_H_
+
+#include <chrono>
+#include "platform/Callback.h"
+#include "HostSim.h"
+
+#define EVENTS_EVENT_SIZE 64
+
+namespace events {
+
+class EventQueue {
+public:
+  EventQueue(unsigned size = 0, unsigned char *buffer = nullptr) : ownThread(false) {
+    (void) size;
+    (void) buffer;
+  }
+
+  template<typename F>
+  int call(F func) {
+    if (ownThread)
+      return HostSim::call_worker(mbed::Callback<void()>(func));
+    return HostSim::call_in_us(0, mbed::Callback<void()>(func));
+  }
+
+  template<typename F>
+  int call_in(std::chrono::milliseconds delay, F func) {
+    return HostSim::call_in_us(delay.count() * 1000, mbed::Callback<void()>(func));
+  }
+
+  bool cancel(int id) {
+    return HostSim::cancel(id);
+  }
+
+  // called by rtos::Thread::start, the events of the queue run as a worker thread in HostSim
+  void dispatch_forever() {
+    ownThread = true;
+  }
+
+private:
+  bool ownThread;
+};
+
+}
+
+namespace mbed {
+
+using events::EventQueue;
+
+inline events::EventQueue* mbed_event_queue() {
+  static events::EventQueue queue;
+  return &queue;
+}
+
+}
+
+#endif
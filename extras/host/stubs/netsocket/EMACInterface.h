@@ -0,0 +1,60 @@
+// host stub, connects the EMAC to a HostStack
+
+#ifndef HOST_STUB_EMACINTERFACE_H_
+#define HOST_STUB_EMACINTERFACE_H_
+
+#include "netsocket/nsapi.h"
+#include "netsocket/OnboardNetworkStack.h"
+#include "EMAC.h"
+#include "HostStack.h"
+
+class EMACInterface {
+public:
+  EMACInterface(EMAC &emac, OnboardNetworkStack &stack) :
+      _emac(emac), _blocking(true), _stack(stack.memory_manager()), _connected(false) {
+  }
+
+  virtual ~EMACInterface() {}
+
+  virtual nsapi_error_t connect() {
+    if (_connected)
+      return NSAPI_ERROR_IS_CONNECTED;
+    _stack.attach(_emac);
+    if (!_emac.power_up())
+      return NSAPI_ERROR_DEVICE_ERROR;
+    _connected = true;
+    return NSAPI_ERROR_OK;
+  }
+
+  virtual nsapi_error_t disconnect() {
+    if (!_connected)
+      return NSAPI_ERROR_NO_CONNECTION;
+    _emac.power_down();
+    _connected = false;
+    return NSAPI_ERROR_OK;
+  }
+
+  virtual nsapi_error_t set_dhcp(bool dhcp) {
+    (void) dhcp;
+    return NSAPI_ERROR_OK;
+  }
+
+  virtual nsapi_connection_status_t get_connection_status() const {
+    return (_connected && _stack.link_up) ? NSAPI_STATUS_GLOBAL_UP : NSAPI_STATUS_DISCONNECTED;
+  }
+
+  /** The stack of the interface in the host build */
+  HostStack& host_stack() {
+    return _stack;
+  }
+
+protected:
+  EMAC &_emac;
+  bool _blocking;
+
+private:
+  HostStack _stack;
+  bool _connected;
+};
+
+#endif
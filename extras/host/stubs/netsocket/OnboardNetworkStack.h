@@ -0,0 +1,24 @@
+// host stub, the stack of the host build is a HostStack per interface
+
+#ifndef HOST_STUB_ONBOARDNETWORKSTACK_H_
+#define HOST_STUB_ONBOARDNETWORKSTACK_H_
+
+#include "netsocket/nsapi.h"
+#include "HostMemoryManager.h"
+
+class OnboardNetworkStack {
+public:
+  static OnboardNetworkStack& get_default_instance() {
+    static OnboardNetworkStack stack;
+    return stack;
+  }
+
+  HostMemoryManager& memory_manager() {
+    return memoryManager;
+  }
+
+private:
+  HostMemoryManager memoryManager;
+};
+
+#endif
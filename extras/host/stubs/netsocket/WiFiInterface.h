@@ -0,0 +1,19 @@
+// host stub
+
+#ifndef HOST_STUB_WIFIINTERFACE_H_
+#define HOST_STUB_WIFIINTERFACE_H_
+
+#include "netsocket/nsapi.h"
+
+class WiFiInterface {
+public:
+  virtual ~WiFiInterface() {}
+  static WiFiInterface* get_default_instance();
+  virtual nsapi_error_t set_credentials(const char *ssid, const char *pass, nsapi_security_t security) = 0;
+  virtual nsapi_error_t connect(const char *ssid, const char *pass, nsapi_security_t security, uint8_t channel) = 0;
+  virtual nsapi_error_t set_channel(uint8_t channel) = 0;
+  virtual int8_t get_rssi() = 0;
+  virtual int scan(WiFiAccessPoint *res, unsigned count) = 0;
+};
+
+#endif
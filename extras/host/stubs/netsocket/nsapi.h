@@ -0,0 +1,76 @@
+// host stub of the Mbed OS network socket types
+
+#ifndef HOST_STUB_NSAPI_H_
+#define HOST_STUB_NSAPI_H_
+
+#include <stdint.h>
+#include <string.h>
+
+typedef int nsapi_error_t;
+
+enum {
+  NSAPI_ERROR_OK = 0,
+  NSAPI_ERROR_WOULD_BLOCK = -3001,
+  NSAPI_ERROR_UNSUPPORTED = -3002,
+  NSAPI_ERROR_PARAMETER = -3003,
+  NSAPI_ERROR_NO_CONNECTION = -3004,
+  NSAPI_ERROR_NO_MEMORY = -3007,
+  NSAPI_ERROR_NO_SSID = -3009,
+  NSAPI_ERROR_AUTH_FAILURE = -3010,
+  NSAPI_ERROR_DEVICE_ERROR = -3012,
+  NSAPI_ERROR_IS_CONNECTED = -3015,
+  NSAPI_ERROR_CONNECTION_TIMEOUT = -3017
+};
+
+enum nsapi_security_t {
+  NSAPI_SECURITY_NONE,
+  NSAPI_SECURITY_WEP,
+  NSAPI_SECURITY_WPA,
+  NSAPI_SECURITY_WPA2,
+  NSAPI_SECURITY_WPA_WPA2,
+  NSAPI_SECURITY_PAP,
+  NSAPI_SECURITY_CHAP,
+  NSAPI_SECURITY_EAP_TLS,
+  NSAPI_SECURITY_PEAP,
+  NSAPI_SECURITY_WPA2_ENT,
+  NSAPI_SECURITY_WPA3,
+  NSAPI_SECURITY_WPA3_WPA2,
+  NSAPI_SECURITY_UNKNOWN
+};
+
+enum nsapi_connection_status_t {
+  NSAPI_STATUS_LOCAL_UP,
+  NSAPI_STATUS_GLOBAL_UP,
+  NSAPI_STATUS_DISCONNECTED,
+  NSAPI_STATUS_CONNECTING
+};
+
+struct nsapi_wifi_ap_t {
+  char ssid[33];
+  uint8_t bssid[6];
+  nsapi_security_t security;
+  int8_t rssi;
+  uint8_t channel;
+};
+
+class WiFiAccessPoint {
+public:
+  WiFiAccessPoint() {
+    memset(&ap, 0, sizeof(ap));
+  }
+  WiFiAccessPoint(nsapi_wifi_ap_t ap) : ap(ap) {
+  }
+  const char* get_ssid() const {
+    return ap.ssid;
+  }
+  int8_t get_rssi() const {
+    return ap.rssi;
+  }
+  uint8_t get_channel() const {
+    return ap.channel;
+  }
+private:
+  nsapi_wifi_ap_t ap;
+};
+
+#endif
@@ -0,0 +1,96 @@
+// host stub of mbed::Callback
+// Stores the function inline like Mbed OS does, so copying a callback doesn't use the heap.
+
+#ifndef HOST_STUB_CALLBACK_H_
+#define HOST_STUB_CALLBACK_H_
+
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+
+namespace mbed {
+
+template<typename F> class Callback;
+
+template<typename R, typename... A>
+class Callback<R(A...)> {
+public:
+  Callback() : thunk(nullptr) {}
+  Callback(std::nullptr_t) : thunk(nullptr) {}
+
+  Callback(R (*func)(A...)) : thunk(nullptr) {
+    if (func) {
+      store(func);
+    }
+  }
+
+  template<typename T, typename U>
+  Callback(U *obj, R (T::*method)(A...)) : thunk(nullptr) {
+    store(Bound<U, R (T::*)(A...)>{obj, method});
+  }
+
+  template<typename T, typename U>
+  Callback(const U *obj, R (T::*method)(A...) const) : thunk(nullptr) {
+    store(Bound<const U, R (T::*)(A...) const>{obj, method});
+  }
+
+  template<typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Callback>::value
+      && !std::is_pointer<typename std::decay<F>::type>::value>::type>
+  Callback(F func) : thunk(nullptr) {
+    store(func);
+  }
+
+  explicit operator bool() const {
+    return thunk != nullptr;
+  }
+
+  R operator()(A... args) const {
+    return thunk(storage, args...);
+  }
+
+  R call(A... args) const {
+    return thunk(storage, args...);
+  }
+
+private:
+  template<typename U, typename M>
+  struct Bound {
+    U *obj;
+    M method;
+    R operator()(A... args) const {
+      return (obj->*method)(args...);
+    }
+  };
+
+  template<typename F>
+  void store(F func) {
+    static_assert(sizeof(F) <= sizeof(storage), "callback too big");
+    static_assert(std::is_trivially_copyable<F>::value, "callback must be trivially copyable");
+    new (storage) F(func);
+    thunk = [](const void *s, A... args) -> R {
+      return (*static_cast<const F*>(s))(args...);
+    };
+  }
+
+  alignas(void*) unsigned char storage[4 * sizeof(void*)];
+  R (*thunk)(const void*, A...);
+};
+
+template<typename R, typename... A>
+Callback<R(A...)> callback(R (*func)(A...)) {
+  return Callback<R(A...)>(func);
+}
+
+template<typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(U *obj, R (T::*method)(A...)) {
+  return Callback<R(A...)>(obj, method);
+}
+
+template<typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(const U *obj, R (T::*method)(A...) const) {
+  return Callback<R(A...)>(obj, method);
+}
+
+}
+
+#endif
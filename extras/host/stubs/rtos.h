@@ -0,0 +1,54 @@
+// host stub of the Mbed OS RTOS API, the threads run in HostSim
+
+#ifndef HOST_STUB_RTOS_H_
+#define HOST_STUB_RTOS_H_
+
+#include <stdint.h>
+#include <chrono>
+#include "platform/Callback.h"
+#include "HostSim.h"
+
+typedef int osStatus;
+typedef int osPriority_t;
+#define osOK             0
+#define osPriorityNormal 24
+
+namespace rtos {
+
+class Mutex : public HostMutex {
+public:
+  bool trylock_for(std::chrono::milliseconds) {
+    return trylock();
+  }
+};
+
+namespace Kernel {
+typedef HostClock Clock;
+}
+
+namespace ThisThread {
+inline void sleep_for(std::chrono::milliseconds ms) {
+  HostSim::sleep(ms.count() * 1000);
+}
+}
+
+class Thread {
+public:
+  Thread(osPriority_t priority = osPriorityNormal, uint32_t stack_size = 0, unsigned char *stack_mem = nullptr, const char *name = nullptr) {
+    (void) priority;
+    (void) stack_size;
+    (void) stack_mem;
+    (void) name;
+  }
+
+  // the thread's function is the dispatch of an event queue, which marks the
+  // queue and returns, its events run in HostSim
+  osStatus start(mbed::Callback<void()> task) {
+    task();
+    return osOK;
+  }
+};
+
+}
+
+#endif
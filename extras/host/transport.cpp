@@ -0,0 +1,55 @@
+// ESPHostEMACBase over SimTransport: the EMAC built and run on the host
+// without Mbed OS and ESPHost. The ESP loops the sent frames back.
+
+#include "HostTest.h"
+#include "HostSim.h"
+#include "HostStack.h"
+#include "SimTransport.h"
+#include "ESPHostEMAC_impl.h"
+
+typedef ESPHostEMACBase<SimTransport> SimEMAC;
+
+static void loopback(int iface, const uint8_t *data, uint16_t len) {
+  SimEsp::instance().air_rx(iface, data, len);
+}
+
+int main() {
+  SimEsp &esp = SimEsp::instance();
+  esp.init_spi();
+  esp.start_warm("test");
+  esp.air_tx = mbed::callback(&loopback);
+
+  HostMemoryManager memory;
+  HostStack stack(memory);
+  SimEMAC &emac = SimEMAC::get_instance();
+  stack.attach(emac);
+  CHECK(emac.power_up());
+  CHECK(stack.link_up);
+
+  uint8_t addr[6];
+  CHECK(emac.get_hwaddr(addr));
+  CHECK(addr[0] == esp.mac[0]);
+
+  const unsigned count = 60;
+  for (unsigned i = 1; i <= count; i++) {
+    CHECK(stack.send(HOST_FRAME_MIN + i * 20, i, HOST_FRAME_ETH_IPV4, i % 3 == 1, i % 3 == 2));
+    HostSim::run_for(5000);
+  }
+  HostSim::run_for(100000);
+
+  ESPHostEMACStats stats;
+  emac.get_stats(stats);
+  CHECK(stats.tx_frames == count);
+  CHECK(stats.rx_frames == count);
+  CHECK(stack.frames == count);
+  CHECK(stack.bad_frames == 0);
+  CHECK(stack.out_of_order == 0);
+  CHECK(memory.heap_used == 0);
+  printf("loopback of %u frames, latency avg %u us max %u us, %u wakeups\n", count,
+      (unsigned) stack.latency.avg(), (unsigned) stack.latency.max, (unsigned) stats.wakeups);
+
+  emac.power_down();
+  HostSim::run_for(100000);
+  CHECK(HostSim::pending() == 0);
+  return host_test_result("transport");
+}
@@ -0,0 +1,384 @@
+#ifndef ESPHOST_EMAC_BASE_H_
+#define ESPHOST_EMAC_BASE_H_
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include "EMAC.h"
+#include "ESPHostEMAC_config.h"
+
+template<class Config> class ESPHostEMACCaptureBase;
+template<class Config> class ESPHostEMACTraceBase;
+
+/** Counters of an ESPHostEMAC interface since power up */
+struct ESPHostEMACStats {
+  uint32_t rx_frames;  // frames read from the transport
+  uint32_t rx_bytes;
+  uint32_t rx_pauses;  // RX pauses because of memory pressure
+  uint32_t tx_frames;  // frames accepted by the transport
+  uint32_t tx_bytes;
+  uint32_t tx_errors;  // frames dropped for no memory or refused by the transport
+  uint32_t wakeups;    // receive task runs, shared by the interfaces
+};
+
+/** ESPHostEMACBase class template
+ *  EMAC over a co-processor transport. Transport is a policy with static
+ *  functions, see ESPHostTransport. The transport provides the platform too:
+ *  the Mutex and Clock types and the scheduler, see ESPHostMbedPlatform.
+ *  Config provides the compile-time configuration, see ESPHostEMACConfig.
+ *
+ *  ESPHostEMAC in ESPHostEMAC.h is the EMAC over the ESPHost library.
+ */
+template<class Transport, class Config = ESPHostEMACConfig>
+class ESPHostEMACBase : public EMAC {
+public:
+
+  /** Handler for raw Layer-2 frames of a registered EtherType
+   *
+   * Called from the receive task with the whole Ethernet frame. The frame
+   * data are valid only during the call.
+   */
+  typedef mbed::Callback<void(const uint8_t *frame, uint16_t len)> raw_input_cb_t;
+
+  ESPHostEMACBase(ESPHostInterface iface = ESPHOST_STATION);
+
+  /** Return the EMAC of the station interface */
+  static ESPHostEMACBase& get_instance(void);
+
+  /** Return the EMAC of the SoftAP interface */
+  static ESPHostEMACBase& get_softap_instance(void);
+
+  /**
+   * Return maximum transmission unit
+   *
+   * @return     MTU in bytes
+   */
+  virtual uint32_t get_mtu_size(void) const;
+
+  /**
+   * Gets memory buffer alignment preference
+   *
+   * Gets preferred memory buffer alignment of the Emac device. IP stack may
+   * or may not align link out memory buffer chains using the alignment.
+   *
+   * @return         Memory alignment requirement in bytes
+   */
+  virtual uint32_t get_align_preference(void) const;
+
+  /**
+   * Return interface name
+   *
+   * @param name Pointer to where the name should be written
+   * @param size Maximum number of character to copy
+   */
+  virtual void get_ifname(char *name, uint8_t size) const;
+
+  /**
+   * Returns size of the underlying interface HW address size.
+   *
+   * @return     HW address size in bytes
+   */
+  virtual uint8_t get_hwaddr_size(void) const;
+
+  /**
+   * Return interface-supplied HW address
+   *
+   * Copies HW address to provided memory, @param addr has to be of correct
+   * size see @a get_hwaddr_size
+   *
+   * HW address need not be provided if this interface does not have its own
+   * HW address configuration; stack will choose address from central system
+   * configuration if the function returns false and does not write to addr.
+   *
+   * @param addr HW address for underlying interface
+   * @return     true if HW address is available
+   */
+  virtual bool get_hwaddr(uint8_t *addr) const;
+
+  /**
+   * Set HW address for interface
+   *
+   * Provided address has to be of correct size, see @a get_hwaddr_size
+   *
+   * Called to set the MAC address to actually use - if @a get_hwaddr is
+   * provided the stack would normally use that, but it could be overridden,
+   * eg for test purposes.
+   *
+   * @param addr Address to be set
+   */
+  virtual void set_hwaddr(const uint8_t *addr);
+
+  /**
+   * Initializes the HW
+   *
+   * @return True on success, False in case of an error.
+   */
+  virtual bool power_up(void);
+
+  /**
+   * Deinitializes the HW
+   *
+   */
+  virtual void power_down(void);
+
+  /**
+   * Sends the packet over the link
+   *
+   * That can not be called from an interrupt context.
+   *
+   * @param buf  Packet to be send
+   * @return     True if the packet was send successfully, False otherwise
+   */
+  virtual bool link_out(emac_mem_buf_t *buf);
+
+  /**
+   * Sets a callback that needs to be called for packets received for that
+   * interface
+   *
+   * @param input_cb Function to be register as a callback
+   */
+  virtual void set_link_input_cb(emac_link_input_cb_t input_cb);
+
+  /**
+   * Sets a callback that needs to be called on link status changes for given
+   * interface
+   *
+   * @param state_cb Function to be register as a callback
+   */
+  virtual void set_link_state_cb(emac_link_state_change_cb_t state_cb);
+
+  /** Add device to a multicast group
+   *
+   * @param address  A multicast group hardware address
+   */
+  virtual void add_multicast_group(const uint8_t *address);
+
+  /** Remove device from a multicast group
+   *
+   * @param address  A multicast group hardware address
+   */
+  virtual void remove_multicast_group(const uint8_t *address);
+
+  /** Request reception of all multicast packets
+   *
+   * @param all True to receive all multicasts
+   *            False to receive only multicasts addressed to specified groups
+   */
+  virtual void set_all_multicast(bool all);
+
+  /** Sets memory manager that is used to handle memory buffers
+   *
+   * @param mem_mngr Pointer to memory manager
+   */
+  virtual void set_memory_manager(EMACMemoryManager &mem_mngr);
+
+  /** Check if RX is paused because of memory pressure
+   *
+   * @return     true if frames are left queued in ESPHost until memory recovers
+   */
+  bool is_rx_paused(void) const;
+
+  /** Return how many times RX was paused because of memory pressure
+   *
+   * @return     count of RX pauses since power up
+   */
+  uint32_t get_rx_pause_count(void) const;
+
+  /** Return the counters of the interface
+   *
+   * @param stats  Structure to fill with the counters
+   */
+  void get_stats(ESPHostEMACStats &stats) const;
+
+  /** Register a handler for frames with an EtherType
+   *
+   * Matching received frames are passed to the handler and not to the IP stack.
+   * Registering a handler for an already registered EtherType replaces it.
+   *
+   * @param ethertype  EtherType in host byte order
+   * @param handler    Function to be called with the received frame
+   * @return           true on success, false if all handler slots are used
+   */
+  bool add_ethertype_handler(uint16_t ethertype, raw_input_cb_t handler);
+
+  /** Unregister the handler for an EtherType
+   *
+   * @param ethertype  EtherType in host byte order
+   */
+  void remove_ethertype_handler(uint16_t ethertype);
+
+  /** Sends a raw Ethernet frame over the link bypassing the IP stack
+   *
+   * The frame must contain the Ethernet header. That can not be called from an interrupt context.
+   *
+   * @param frame  Frame to be send
+   * @param len    Length of the frame in bytes
+   * @return       True if the frame was send successfully, False otherwise
+   */
+  bool send_raw(const uint8_t *frame, uint16_t len);
+
+  /** Sets a capture tap for the frames sent and received
+   *
+   * @param capture  Capture to record the frames, NULL to remove the tap
+   */
+  void set_capture(ESPHostEMACCaptureBase<Config> *capture);
+
+  /** Sets a trace to record the calls to ESPHost and their timing
+   *
+   * The trace records the calls of both interfaces.
+   *
+   * @param trace  Trace to record the calls, NULL to stop tracing
+   */
+  static void set_trace(ESPHostEMACTraceBase<Config> *trace);
+
+  /** Sets the periods of the receive task which services the ESP
+   *
+   * One receive task services the ESP for both interfaces.
+   * The idle period is used after Config::receive_idle_runs runs without traffic.
+   * Sending a packet while idle runs the receive task immediately, so does the
+   * data-ready line of the ESP if the transport has it.
+   *
+   * @param active  Period while there is traffic
+   * @param idle    Period while there is no traffic
+   */
+  static void set_receive_period(std::chrono::milliseconds active, std::chrono::milliseconds idle);
+
+  /** Return how many times the receive task woke up to service the ESP
+   *
+   * @return     count of receive task runs since power up
+   */
+  static uint32_t get_wakeup_count(void);
+
+  /** Sets the function to recover a not responding ESP
+   *
+   * If there was no successful exchange with the ESP for Config::health_timeout
+   * or after Config::health_tx_error_limit failed sends in a row, the receive task
+   * stops and the ESP is probed with a request in the worker thread of the transport.
+   * If the probe fails, the links are reported down and the function is called
+   * in the worker thread. Meanwhile sending fails without waiting for the ESP.
+   * If the function returns true, the restore function of each powered up
+   * interface is called, see set_restore_cb.
+   *
+   * @param recovery_cb  Function to reset and re-initialize the ESP, returns true on success
+   */
+  static void set_recovery_cb(mbed::Callback<bool()> recovery_cb);
+
+  /** Sets the function to restore the interface after a recovery of the ESP
+   *
+   * Called in the worker thread after the ESP was reset and re-initialized,
+   * for example to rejoin the AP or to restart the SoftAP. The link is
+   * reported up if it returns true. Without it the link stays down.
+   *
+   * @param restore_cb  Function to restore the interface on the ESP, returns true on success
+   */
+  void set_restore_cb(mbed::Callback<bool()> restore_cb);
+
+  /** Return the RAM used by the EMACs
+   *
+   * The static memory with the worker thread and its stack, the statics of the
+   * transport and the objects of the created interfaces. The frames in the
+   * memory manager and a capture or trace set by the application are not included.
+   *
+   * @return     size in bytes
+   */
+  static size_t get_ram_footprint(void);
+
+  /** Return the count of heap allocations on the datapath
+   *
+   * Counts the buffers the EMAC allocates from the heap of the memory manager:
+   * the received frames and the aligned copies of chained or unaligned frames
+   * to send. With Config::static_alloc it stays 0. The messages ESPHost
+   * allocates for each frame are not counted, the EMAC doesn't control them.
+   *
+   * @return     count of heap allocations since power up
+   */
+  static uint32_t get_datapath_heap_allocs(void);
+
+private:
+  static void receiveTask();
+  static void scheduleReceiveTask(bool activity);
+  static void wakeReceiveTask();
+  static void runReceiveTaskNow();
+  static void dataReady();
+  static void dataReadyWake();
+  static bool checkHealth();
+  static void recoveryTask();
+  bool receiveFrames();
+  emac_mem_buf_t* lowLevelInput(uint16_t size);
+  bool rawInput(uint16_t size);
+  emac_mem_buf_t* heldInput();
+  void stackInput(emac_mem_buf_t *buf);
+  bool rxFlowResume();
+  void rxFlowPause();
+  bool hasHeadroom(uint8_t frames);
+  emac_mem_buf_t* allocRx(uint32_t size);
+  bool linkOutStaged(emac_mem_buf_t *buf);
+
+  // calls to ESPHost go through these to be captured and traced
+  static void espCommunicate();
+  uint16_t espPeekRx();
+  void espGetRx(uint8_t *data, uint16_t size);
+  int espSend(uint8_t *data, uint16_t len);
+
+  const ESPHostInterface iface;
+
+  // the ESP is serviced for all powered up interfaces by one receive task
+  static ESPHostEMACBase* poweredUp[ESPHOST_INTERFACE_COUNT];
+  static int receiveTaskHandle;
+  static bool receiveTaskActive; // a receive task is queued or running, there is one chain of them
+  static volatile bool dataReadyPending;
+  static volatile bool txActivity;
+  static uint8_t txExchanges; // to send while RX waits, since the ESPHost queue was empty
+  static uint8_t idleRuns;
+  static uint32_t wakeupCount;
+  static std::chrono::milliseconds activePeriod;
+  static std::chrono::milliseconds idlePeriod;
+
+  static typename Transport::Clock::time_point lastExchange;
+  static uint8_t txErrorStreak;
+  static mbed::Callback<bool()> recoveryCb;
+  static volatile bool recovering; // the ESP is probed or reset in the worker thread
+  static uint32_t datapathHeapAllocs;
+  alignas(8) static unsigned char workerStack[Config::worker_stack_size];
+  static uint8_t instanceCount; // of the created EMACs
+
+  volatile bool rxPaused;
+  typename Transport::Clock::time_point rxPauseStart;
+  typename Transport::Clock::time_point rxResumeTime;
+  uint32_t rxPauseCount;
+
+  uint32_t rxFrames;
+  uint32_t rxBytes;
+  uint32_t txFrames;
+  uint32_t txBytes;
+  uint32_t txErrors;
+
+  struct RawHandler {
+    uint16_t ethertype;
+    raw_input_cb_t cb;
+  };
+  RawHandler rawHandlers[Config::raw_handlers_max];
+  uint8_t rawHandlerCount;
+  alignas(Config::buff_alignment) static uint8_t rawRxBuffer[Config::mtu_size + Config::eth_header_size];
+  static ESPHostEMACBase* rawRxHeld; // its frame for the stack waits in rawRxBuffer for a buffer
+  static uint16_t rawRxHeldSize;
+  // only used with Config::static_alloc
+  alignas(Config::buff_alignment) static uint8_t txBuffer[Config::static_alloc ? Config::mtu_size + Config::eth_header_size : 1];
+
+  EMACMemoryManager* memoryManager;
+  ESPHostEMACCaptureBase<Config>* capture;
+  static ESPHostEMACTraceBase<Config>* trace;
+
+  friend class ESPHostEMACInterface; // to share the mutex
+  friend class WhdSoftAPInterface;
+  static typename Transport::Mutex wifiLockMutex;
+
+  emac_link_input_cb_t emac_link_input_cb;
+  emac_link_state_change_cb_t emac_link_state_cb;
+  mbed::Callback<bool()> restoreCb;
+};
+
+#endif
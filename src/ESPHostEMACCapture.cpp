@@ -0,0 +1,3 @@
+#include "ESPHostEMACCapture_impl.h"
+
+template class ESPHostEMACCaptureBase<ESPHostEMACConfig>;
@@ -0,0 +1,94 @@
+#ifndef ESPHOST_EMAC_CAPTURE_H_
+#define ESPHOST_EMAC_CAPTURE_H_
+
+#include <stdint.h>
+#include "Arduino.h"
+#include "mbed.h"
+#include "rtos.h"
+#include "ESPHostEMAC_config.h"
+
+/** ESPHostEMACCaptureBase class template
+ *  Capture tap for the ESPHostEMAC datapath.
+ *
+ *  Keeps the first Config::capture_snaplen bytes of the last Config::capture_ring_size
+ *  frames with timestamps and exports them in pcap format. Config is the Config of the
+ *  EMAC the capture is set on.
+ */
+template<class Config = ESPHostEMACConfig>
+class ESPHostEMACCaptureBase {
+public:
+
+  enum Direction {
+    RX = 0x01,
+    TX = 0x02,
+    BOTH = RX | TX
+  };
+
+  ESPHostEMACCaptureBase();
+
+  /** Set the capture filter
+   *
+   * @param directions  Directions to capture
+   * @param ethertype   EtherType in host byte order to capture, 0 for all
+   */
+  void set_filter(uint8_t directions, uint16_t ethertype = 0);
+
+  /** Start capturing */
+  void start();
+
+  /** Stop capturing */
+  void stop();
+
+  /** Remove all captured frames */
+  void clear();
+
+  /** Return the count of frames captured since start or clear
+   *
+   * Frames over Config::capture_ring_size overwrite the oldest frames.
+   *
+   * @return     count of captured frames
+   */
+  uint32_t get_captured_count() const;
+
+  /** Write the captured frames in pcap format
+   *
+   * The frames stay in the capture buffer.
+   *
+   * @param out  Stream to write to (Serial, a client, a file)
+   * @return     number of frames written
+   */
+  size_t write_pcap(arduino::Print &out);
+
+  /** Record a frame. Called by the EMAC.
+   *
+   * @param dir    Direction of the frame
+   * @param frame  Frame data
+   * @param len    Length of the frame
+   */
+  void record(Direction dir, const uint8_t *frame, uint16_t len);
+
+private:
+  static void write16(arduino::Print &out, uint16_t v);
+  static void write32(arduino::Print &out, uint32_t v);
+
+  struct Record {
+    uint64_t timestamp;
+    uint16_t len;
+    uint16_t caplen;
+    uint8_t data[Config::capture_snaplen];
+  };
+
+  Record ring[Config::capture_ring_size];
+  uint32_t count;
+  volatile bool running;
+  uint8_t directions;
+  uint16_t ethertype;
+  rtos::Mutex mutex;
+};
+
+typedef ESPHostEMACCaptureBase<> ESPHostEMACCapture;
+
+// instantiated in ESPHostEMACCapture.cpp, include ESPHostEMACCapture_impl.h for another Config
+extern template class ESPHostEMACCaptureBase<ESPHostEMACConfig>;
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef ESPHOST_EMAC_CAPTURE_IMPL_H_
+#define ESPHOST_EMAC_CAPTURE_IMPL_H_
+
+// ESPHostEMACCaptureBase member definitions. Included by ESPHostEMACCapture.cpp for
+// ESPHostEMACConfig and by code which uses an EMAC with another Config.
+
+#include "ESPHostEMACCapture.h"
+
+#define PCAP_MAGIC          0xa1b2c3d4
+#define PCAP_VERSION_MAJOR  2
+#define PCAP_VERSION_MINOR  4
+#define PCAP_LINKTYPE_ETHERNET 1
+
+template<class Config>
+void ESPHostEMACCaptureBase<Config>::write16(arduino::Print &out, uint16_t v) {
+  uint8_t b[2] = {(uint8_t) v, (uint8_t) (v >> 8)};
+  out.write(b, sizeof(b));
+}
+
+template<class Config>
+void ESPHostEMACCaptureBase<Config>::write32(arduino::Print &out, uint32_t v) {
+  uint8_t b[4] = {(uint8_t) v, (uint8_t) (v >> 8), (uint8_t) (v >> 16), (uint8_t) (v >> 24)};
+  out.write(b, sizeof(b));
+}
+
+template<class Config>
+ESPHostEMACCaptureBase<Config>::ESPHostEMACCaptureBase() :
+    count(0), running(false), directions(BOTH), ethertype(0) {
+
+}
+
+template<class Config>
+void ESPHostEMACCaptureBase<Config>::set_filter(uint8_t directions, uint16_t ethertype) {
+  mutex.lock();
+  this->directions = directions;
+  this->ethertype = ethertype;
+  mutex.unlock();
+}
+
+template<class Config>
+void ESPHostEMACCaptureBase<Config>::start() {
+  running = true;
+}
+
+template<class Config>
+void ESPHostEMACCaptureBase<Config>::stop() {
+  running = false;
+}
+
+template<class Config>
+void ESPHostEMACCaptureBase<Config>::clear() {
+  mutex.lock();
+  count = 0;
+  mutex.unlock();
+}
+
+template<class Config>
+uint32_t ESPHostEMACCaptureBase<Config>::get_captured_count() const {
+  return count;
+}
+
+template<class Config>
+void ESPHostEMACCaptureBase<Config>::record(Direction dir, const uint8_t *frame, uint16_t len) {
+  if (!running || !(directions & dir))
+    return;
+  if (ethertype && (len < Config::eth_header_size
+      || ((frame[Config::eth_type_offset] << 8) | frame[Config::eth_type_offset + 1]) != ethertype))
+    return;
+
+  mutex.lock();
+  Record &r = ring[count % Config::capture_ring_size];
+  r.timestamp = ticker_read_us(get_us_ticker_data());
+  r.len = len;
+  r.caplen = (len < Config::capture_snaplen) ? len : Config::capture_snaplen;
+  memcpy(r.data, frame, r.caplen);
+  count++;
+  mutex.unlock();
+}
+
+template<class Config>
+size_t ESPHostEMACCaptureBase<Config>::write_pcap(arduino::Print &out) {
+  write32(out, PCAP_MAGIC);
+  write16(out, PCAP_VERSION_MAJOR);
+  write16(out, PCAP_VERSION_MINOR);
+  write32(out, 0); // thiszone
+  write32(out, 0); // sigfigs
+  write32(out, Config::capture_snaplen);
+  write32(out, PCAP_LINKTYPE_ETHERNET);
+
+  mutex.lock();
+  uint32_t end = count;
+  mutex.unlock();
+  uint32_t start = (end > Config::capture_ring_size) ? end - Config::capture_ring_size : 0;
+
+  size_t n = 0;
+  for (uint32_t i = start; i < end; i++) {
+    Record r;
+    mutex.lock();
+    if (count - i > Config::capture_ring_size) { // overwritten while writing
+      mutex.unlock();
+      continue;
+    }
+    r = ring[i % Config::capture_ring_size];
+    mutex.unlock();
+
+    write32(out, (uint32_t) (r.timestamp / 1000000));
+    write32(out, (uint32_t) (r.timestamp % 1000000));
+    write32(out, r.caplen);
+    write32(out, r.len);
+    out.write(r.data, r.caplen);
+    n++;
+  }
+  return n;
+}
+
+#endif
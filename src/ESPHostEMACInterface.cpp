@@ -1,7 +1,18 @@
 #include <ESPHostEMACInterface.h>
+#include "Arduino.h"
+#include "ESPHostEMAC_config.h"
 #include "CEspControl.h"
 #include "CCtrlWrapper.h"
 
+// the reset line of the ESP32 of the u-blox NINA module, defined by the variant (Nano RP2040 Connect)
+#if !defined(ESPHOST_RESET_PIN) && defined(NINA_RESETN)
+#define ESPHOST_RESET_PIN NINA_RESETN
+#endif
+
+#ifndef ESPHOST_RESET_PIN
+#warning "ESPHOST_RESET_PIN is not defined, a not responding ESP is not recovered"
+#endif
+
 #define DEBUG_SILENT  0
 #define DEBUG_WARNING 1
 #define DEBUG_INFO    2
@@ -10,8 +21,23 @@
 
 #define ESPHOST_INIT_TIMEOUT_MS             10000
 
+// values of the ESP-IDF wifi_ps_type_t
+#define ESP_WIFI_PS_NONE       0
+#define ESP_WIFI_PS_MIN_MODEM  1
+#define ESP_WIFI_PS_MAX_MODEM  2
+
 static ESPHostEMACInterface* espHostObject;
+
+// a power on of the MCU powered on the ESP too, it boots and sends the init event
+static bool mcuPoweredOn() {
+#if DEVICE_RESET_REASON
+  return mbed::ResetReason::get() == RESET_REASON_POWER_ON;
+#else
+  return false;
+#endif
+}
 bool ESPHostEMACInterface::wifiHwInitialized = false;
+bool ESPHostEMACInterface::wifiHwAdopted = false;
 
 #include <stdarg.h>
 
@@ -27,9 +53,14 @@ static void debug(int condition, const char *format, ...) {
 }
 
 ESPHostEMACInterface::ESPHostEMACInterface(bool debug, ESPHostEMAC &emac, OnboardNetworkStack &stack) :
-    EMACInterface(emac, stack), isConnected(false), mutex(emac.wifiLockMutex) {
+    EMACInterface(emac, stack), emac(emac), latencyProfile(LATENCY_PROFILE_BALANCED), recoveryCount(0), lastRecoveryTime(0),
+    isConnected(false), mutex(emac.wifiLockMutex) {
 
   espHostObject = this;
+#ifdef ESPHOST_RESET_PIN
+  emac.set_recovery_cb(mbed::callback(this, &ESPHostEMACInterface::recover)); // arms the watchdog
+#endif
+  emac.set_restore_cb(mbed::callback(this, &ESPHostEMACInterface::restore));
   ap.ssid[0] = 0;
 
   if (debug) {
@@ -90,31 +121,196 @@ nsapi_error_t ESPHostEMACInterface::connect(const char *ssid, const char *pass,
   return ret;
 }
 
-bool ESPHostEMACInterface::initHW() {
+/*
+ * The mutex is locked only for the calls to ESPHost, not while waiting
+ * for the init event, so the EMAC isn't blocked during the boot of the ESP.
+ * ESPHost's initSpiDriver only sets up SPI and the CS, handshake and data-ready
+ * pins, it doesn't reset the ESP. So after a reset of the MCU the ESP may still
+ * run and with adopt it is probed instead of waiting for an init event which
+ * doesn't come. The recovery resets the ESP itself and doesn't probe it while
+ * it boots.
+ */
+bool ESPHostEMACInterface::initHW(bool adopt) {
   if (wifiHwInitialized)
     return true;
 
+  ESPHostEMAC::wifiLockMutex.lock();
   //  CEspControl::getInstance().listenForStationDisconnectEvent(CLwipIf::disconnectEventcb);
   CEspControl::getInstance().listenForInitEvent(initEventCb);
-  if (CEspControl::getInstance().initSpiDriver() != 0)
+  if (CEspControl::getInstance().initSpiDriver() != 0) {
+    ESPHostEMAC::wifiLockMutex.unlock();
     return false;
+  }
 
-  int time_num = 0;
-  while (!wifiHwInitialized && time_num < ESPHOST_INIT_TIMEOUT_MS) {
-    CEspControl::getInstance().communicateWithEsp();
-    delay(100);
-    time_num++;
+  CEspControl::getInstance().communicateWithEsp();
+  ESPHostEMAC::wifiLockMutex.unlock();
+
+  // An ESP which kept running over a reset of the MCU doesn't send the init event again,
+  // so it is probed with a control request. A booting ESP doesn't answer it and the probe
+  // costs the control timeout, so the init event is awaited first. After a power on the
+  // ESP boots with the MCU, else it gets ESPHostEMACConfig::adopt_wait.
+  unsigned long start = millis();
+  waitInitEvent(start, (adopt && !mcuPoweredOn()) ? ESPHostEMACConfig::adopt_wait.count() : ESPHOST_INIT_TIMEOUT_MS);
+  if (adopt && !wifiHwInitialized) {
+    WifiMac_t MAC;
+    MAC.mode = WIFI_MODE_STA;
+    ESPHostEMAC::wifiLockMutex.lock();
+    if (CEspControl::getInstance().getWifiMacAddress(MAC) == ESP_CONTROL_OK) {
+      wifiHwInitialized = true;
+      wifiHwAdopted = true;
+    }
+    ESPHostEMAC::wifiLockMutex.unlock();
   }
+  waitInitEvent(start, ESPHOST_INIT_TIMEOUT_MS);
   return wifiHwInitialized;
 
 }
 
+void ESPHostEMACInterface::waitInitEvent(unsigned long start, unsigned long timeout) {
+  while (!wifiHwInitialized && millis() - start < timeout) {
+    delay(10);
+    ESPHostEMAC::wifiLockMutex.lock();
+    CEspControl::getInstance().communicateWithEsp();
+    ESPHostEMAC::wifiLockMutex.unlock();
+  }
+}
+
+/*
+ * Pulses the reset line of the ESP.
+ */
+void ESPHostEMACInterface::resetEsp() {
+#ifdef ESPHOST_RESET_PIN
+  pinMode(ESPHOST_RESET_PIN, OUTPUT);
+  digitalWrite(ESPHOST_RESET_PIN, LOW);
+  delay(ESPHostEMACConfig::reset_pulse.count());
+  digitalWrite(ESPHOST_RESET_PIN, HIGH);
+#endif
+}
+
+/*
+ * Called by the EMAC's SPI link health watchdog in its worker thread if the ESP
+ * doesn't respond. Resets the ESP and waits for it over the init path.
+ * The watchdog is armed only with ESPHOST_RESET_PIN, initializing the SPI driver
+ * again doesn't help a hung ESP.
+ * The EMACs then restore their interfaces, see restore.
+ */
+bool ESPHostEMACInterface::recover() {
+  debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : ESP not responding, resetting\n");
+  recoveryStart = rtos::Kernel::Clock::now();
+
+  resetEsp();
+  wifiHwInitialized = false;
+  wifiHwAdopted = false; // the reset ESP has no association to adopt
+  bool ok = initHW(false);
+  if (!ok) {
+    debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : ESP init failed\n");
+    return false;
+  }
+  recoveryCount++;
+  lastRecoveryTime = std::chrono::duration_cast<std::chrono::milliseconds>(rtos::Kernel::Clock::now() - recoveryStart);
+  return true;
+}
+
+/*
+ * Called by the EMAC after a recovery of the ESP, if the station EMAC is powered up.
+ * Sets the power save mode of the latency profile and rejoins the AP.
+ */
+bool ESPHostEMACInterface::restore() {
+  applyPowerSave();
+  if (!isConnected)
+    return false;
+  mutex.lock();
+  int rv = CEspControl::getInstance().connectAccessPoint(ap);
+  mutex.unlock();
+  if (rv != ESP_CONTROL_OK) {
+    debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : rejoin failed\n");
+    return false;
+  }
+  lastRecoveryTime = std::chrono::duration_cast<std::chrono::milliseconds>(rtos::Kernel::Clock::now() - recoveryStart);
+  debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : ESP recovered in %d ms\n", (int) lastRecoveryTime.count());
+  return true;
+}
+
+nsapi_error_t ESPHostEMACInterface::set_latency_profile(latency_profile_t profile) {
+  latencyProfile = profile;
+  switch (profile) {
+    case LATENCY_PROFILE_LOW_LATENCY:
+      emac.set_receive_period(ESPHostEMACConfig::low_latency_period, ESPHostEMACConfig::low_latency_period);
+      break;
+    case LATENCY_PROFILE_LOW_POWER:
+      emac.set_receive_period(ESPHostEMACConfig::receive_task_period, ESPHostEMACConfig::low_power_idle_period);
+      break;
+    default:
+      emac.set_receive_period(ESPHostEMACConfig::receive_task_period, ESPHostEMACConfig::receive_task_period);
+      break;
+  }
+  if (!wifiHwInitialized)
+    return NSAPI_ERROR_OK;
+  return applyPowerSave();
+}
+
+nsapi_error_t ESPHostEMACInterface::applyPowerSave() {
+  int mode;
+  switch (latencyProfile) {
+    case LATENCY_PROFILE_LOW_LATENCY:
+      mode = ESP_WIFI_PS_NONE;
+      break;
+    case LATENCY_PROFILE_LOW_POWER:
+      mode = ESP_WIFI_PS_MAX_MODEM;
+      break;
+    default:
+      mode = ESP_WIFI_PS_MIN_MODEM;
+      break;
+  }
+  mutex.lock();
+  int rv = CEspControl::getInstance().setPowerSaveMode(mode);
+  if (rv != ESP_CONTROL_OK && mode == ESP_WIFI_PS_NONE) { // some ESP firmware doesn't allow to turn modem sleep off
+    debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : power save off not supported, using minimum modem sleep\n");
+    rv = CEspControl::getInstance().setPowerSaveMode(ESP_WIFI_PS_MIN_MODEM);
+  }
+  mutex.unlock();
+  if (rv != ESP_CONTROL_OK) {
+    debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : set power save mode %d failed\n", mode);
+    return NSAPI_ERROR_DEVICE_ERROR;
+  }
+  debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : power save mode %d\n", mode);
+  return NSAPI_ERROR_OK;
+}
+
+/*
+ * If the ESP kept running over a reset of the MCU and is still associated
+ * with the configured SSID, the association is used without a new join.
+ */
+bool ESPHostEMACInterface::adoptAssociation() {
+  if (!wifiHwAdopted)
+    return false;
+  wifiHwAdopted = false;
+
+  WifiApCfg_t cfg;
+  mutex.lock();
+  int rv = CEspControl::getInstance().getAccessPointConfig(cfg);
+  mutex.unlock();
+  if (rv != ESP_CONTROL_OK || strncmp((char*) cfg.ssid, (char*) ap.ssid, sizeof(ap.ssid)) != 0) {
+    debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : ESP not associated with %s, joining\n", ap.ssid);
+    return false;
+  }
+  memcpy(cfg.pwd, ap.pwd, sizeof(cfg.pwd));
+  cfg.encryption_mode = ap.encryption_mode;
+  ap = cfg;
+  debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : ESP already associated with %s\n", ap.ssid);
+  return true;
+}
+
 nsapi_error_t ESPHostEMACInterface::connect() {
   nsapi_error_t ret;
+  rtos::Kernel::Clock::time_point start = rtos::Kernel::Clock::now();
 
   if (!initHW())
     return false;
 
+#ifndef ESPHOST_RESET_PIN
+  debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : no ESPHOST_RESET_PIN, a not responding ESP is not recovered\n");
+#endif
   if (ap.ssid[0] == '\0') {
     debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : connect , ssid is missing\n");
     ret = NSAPI_ERROR_NO_SSID;
@@ -122,22 +318,34 @@ nsapi_error_t ESPHostEMACInterface::connect() {
     debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : connect is already connected\n");
     ret = NSAPI_ERROR_IS_CONNECTED;
   } else {
-    debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : connecting WIFI\n");
+    bool adopted = adoptAssociation();
+    // balanced is the default of a booted ESP, an adopted one keeps the mode set before the reset of the MCU
+    if (adopted || latencyProfile != LATENCY_PROFILE_BALANCED) {
+      applyPowerSave();
+    }
+    if (!adopted) {
+      debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : connecting WIFI\n");
+    }
     mutex.lock();
-    if (CEspControl::getInstance().connectAccessPoint(ap) != ESP_CONTROL_OK) {
+    if (!adopted && CEspControl::getInstance().connectAccessPoint(ap) != ESP_CONTROL_OK) {
       mutex.unlock();
       debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : Connect failed; wrong parameter ?\n");
       ret = NSAPI_ERROR_PARAMETER;
     } else {
-      CEspControl::getInstance().getAccessPointConfig(ap);
+      if (!adopted) {
+        CEspControl::getInstance().getAccessPointConfig(ap);
+      }
       mutex.unlock();
       debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : connecting EMAC\n");
       ret = EMACInterface::connect();
       /* EMAC is waiting for UP conection , UP means we join an hotspot and  IP services running */
       if (ret == NSAPI_ERROR_OK || ret == NSAPI_ERROR_IS_CONNECTED) {
         debug(debug_level >= DEBUG_LOG, "ESPHostEMACInterface : Connected to emac! (using ssid %s , passw %s  )\n", ap.ssid, ap.pwd);
+        debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : RAM footprint %u bytes\n", (unsigned) get_ram_footprint());
         isConnected = true;
         ret = NSAPI_ERROR_OK;
+        debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : connected in %d ms\n",
+            (int) std::chrono::duration_cast<std::chrono::milliseconds>(rtos::Kernel::Clock::now() - start).count());
       } else {
         debug(debug_level >= DEBUG_WARNING, "ESPHostEMACInterface : EMAC Fail to connect NSAPI_ERROR %d\n", ret);
         mutex.lock();
@@ -197,13 +405,17 @@ int ESPHostEMACInterface::scan(WiFiAccessPoint *res, unsigned int count) {
   if (!initHW())
     return false;
 
+  // ESPHost appends every access point it found to the list, which is freed on return,
+  // only the first count are copied
   std::vector<AccessPoint_t> accessPoints;
   mutex.lock();
   int rv = CEspControl::getInstance().getAccessPointScanList(accessPoints);
   mutex.unlock();
   if (rv != ESP_CONTROL_OK)
     return NSAPI_ERROR_DEVICE_ERROR;
-  count = accessPoints.size();
+  if (accessPoints.size() < count) {
+    count = accessPoints.size();
+  }
   debug(debug_level >= DEBUG_INFO, "ESPHostEMACInterface : Scan find %d HotSpot\n", count);
 
   for (uint32_t i = 0; i < count; i++) {
@@ -222,6 +434,10 @@ int ESPHostEMACInterface::scan(WiFiAccessPoint *res, unsigned int count) {
   return count;
 }
 
+size_t ESPHostEMACInterface::get_ram_footprint() const {
+  return sizeof(*this) + ESPHostEMAC::get_ram_footprint();
+}
+
 #if MBED_CONF_ESPHOST_PROVIDE_DEFAULT
 WiFiInterface *WiFiInterface::get_default_instance()
 {
@@ -18,6 +18,16 @@
  */
 class ESPHostEMACInterface : public WiFiInterface, public EMACInterface {
 public:
+
+  /** Latency profiles. They set the Wi-Fi power save mode of the ESP
+   *  and the period in which the EMAC services the ESP.
+   */
+  enum latency_profile_t {
+    LATENCY_PROFILE_LOW_LATENCY, /*!< no modem sleep, ESP serviced every ESPHostEMACConfig::low_latency_period */
+    LATENCY_PROFILE_BALANCED,    /*!< minimum modem sleep, ESP serviced every ESPHostEMACConfig::receive_task_period (default) */
+    LATENCY_PROFILE_LOW_POWER    /*!< maximum modem sleep, ESP serviced every ESPHostEMACConfig::low_power_idle_period while idle or on data-ready */
+  };
+
   ESPHostEMACInterface(bool debug = false, ESPHostEMAC &emac = ESPHostEMAC::get_instance(), OnboardNetworkStack &stack = OnboardNetworkStack::get_default_instance());
 
   /** Start the interface
@@ -98,16 +108,74 @@ public:
    */
   int scan(WiFiAccessPoint *res, unsigned count);
 
+  /** Set the latency profile
+   *
+   * If the ESP is not initialized yet, the power save mode is set at connect.
+   *
+   * @param  profile  Latency profile to use
+   * @return          0 on success, or error code on failure
+   */
+  nsapi_error_t set_latency_profile(latency_profile_t profile);
+
+  /** Get the latency profile
+   *
+   * @return          The current latency profile
+   */
+  latency_profile_t get_latency_profile() const {
+    return latencyProfile;
+  }
+
+  /** Get the count of ESP resets by the SPI link health watchdog
+   *
+   * The ESP is reset with ESPHOST_RESET_PIN. Without it the watchdog isn't armed
+   * and the count stays 0.
+   *
+   * @return          Count of recoveries of a not responding ESP
+   */
+  uint32_t get_recovery_count() const {
+    return recoveryCount;
+  }
+
+  /** Get the duration of the last ESP recovery
+   *
+   * @return          Time from the ESP reset to the rejoined AP of the last recovery, to the initialized ESP if not connected
+   */
+  std::chrono::milliseconds get_last_recovery_time() const {
+    return lastRecoveryTime;
+  }
+
+  /** Get the RAM used by the driver
+   *
+   * The interface and the EMACs. The list of a scan is allocated by ESPHost
+   * only during the scan. Printed at connect with the info debug level.
+   *
+   * @return          size in bytes
+   */
+  size_t get_ram_footprint() const;
+
 private:
   static bool wifiHwInitialized;
+  static bool wifiHwAdopted; // the ESP kept running over a reset of the MCU
   WifiApCfg_t ap;
+  ESPHostEMAC &emac;
+  latency_profile_t latencyProfile;
+  uint32_t recoveryCount;
+  std::chrono::milliseconds lastRecoveryTime;
+  rtos::Kernel::Clock::time_point recoveryStart;
   volatile bool isConnected;
   rtos::Mutex& mutex;
   uint8_t debug_level;
 
   static int initEventCb(CCtrlMsgWrapper *resp);
 
-  bool initHW();
+  friend class WhdSoftAPInterface; // to init the ESP
+  static bool initHW(bool adopt = true);
+  static void waitInitEvent(unsigned long start, unsigned long timeout);
+  nsapi_error_t applyPowerSave();
+  static void resetEsp();
+  bool recover();
+  bool restore();
+  bool adoptAssociation();
 
   nsapi_security_t sec2nsapisec(int sec) {
     nsapi_security_t sec_out;
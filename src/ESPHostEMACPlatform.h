@@ -0,0 +1,119 @@
+#ifndef ESPHOST_EMAC_PLATFORM_H_
+#define ESPHOST_EMAC_PLATFORM_H_
+
+#include <stdint.h>
+#include <chrono>
+#include "mbed.h"
+#include "rtos.h"
+#include <mbed_events.h>
+
+/** ESPHostMbedPlatform
+ *  Scheduler, clock and lock of ESPHostEMACBase on Mbed OS.
+ *
+ *  A transport policy of ESPHostEMACBase provides these types and functions,
+ *  usually by deriving from a platform. A host build derives its simulated
+ *  transport from a platform with a simulated clock and scheduler.
+ */
+struct ESPHostMbedPlatform {
+
+  typedef rtos::Mutex Mutex;
+  typedef rtos::Kernel::Clock Clock;
+
+  /** Run the function in the context of the receive task, returns the event id */
+  static int call(mbed::Callback<void()> func) {
+    return mbed::mbed_event_queue()->call(func);
+  }
+
+  /** Run the function in the context of the receive task after the delay, returns the event id */
+  static int call_in(std::chrono::milliseconds delay, mbed::Callback<void()> func) {
+    return mbed::mbed_event_queue()->call_in(delay, func);
+  }
+
+  /** Cancel a pending function, returns false if it is already running or done */
+  static bool cancel(int id) {
+    return mbed::mbed_event_queue()->cancel(id);
+  }
+
+  /** Size of the event queue of the worker thread */
+  static constexpr unsigned worker_queue_size = 4 * EVENTS_EVENT_SIZE;
+
+  /** Run the function in the worker thread, for work which blocks for seconds
+   *  like the reset of the ESP. The thread is started at the first call on the
+   *  stack of the caller (8-byte aligned), later calls don't change it.
+   *  Neither the thread nor its queue allocate from the heap.
+   */
+  static int call_worker(mbed::Callback<void()> func, unsigned char *stack, uint32_t stack_size) {
+    static unsigned char queueBuffer[worker_queue_size];
+    static events::EventQueue queue(worker_queue_size, queueBuffer);
+    static rtos::Thread thread(osPriorityNormal, stack_size, stack, "ESPHost worker");
+    static bool started = false;
+    if (!started) {
+      started = true;
+      thread.start(mbed::callback(&queue, &events::EventQueue::dispatch_forever));
+    }
+    return queue.call(func);
+  }
+
+  /** Sample the data-ready line of the ESP every period and call the function
+   *  from the ticker interrupt while it is high, an empty function stops it.
+   *  ESPHost owns the pin, so it is only read, no interrupt is attached to it.
+   *  The low power ticker doesn't keep the MCU out of deep sleep.
+   *  Without ESPHOST_DATA_READY_PIN the ESP is only polled.
+   */
+  static void attach_data_ready(mbed::Callback<void()> func, std::chrono::milliseconds period) {
+#ifdef ESPHOST_DATA_READY_PIN
+    static mbed::DigitalIn line(ESPHOST_DATA_READY_PIN);
+    dataReadyTicker().detach();
+    dataReadyLine() = &line;
+    dataReadyFunc() = func;
+    if (func) {
+      dataReadyTicker().attach(mbed::callback(&sampleDataReady), period);
+    }
+#else
+    (void) func;
+    (void) period;
+#endif
+  }
+
+  /** Return the static RAM of the platform: the worker thread with its queue
+   *  and the sampling of the data-ready line. The stack of the worker is the caller's.
+   */
+  static size_t ram_footprint() {
+    size_t size = sizeof(events::EventQueue) + worker_queue_size + sizeof(rtos::Thread) + sizeof(bool);
+#ifdef ESPHOST_DATA_READY_PIN
+    size += sizeof(mbed::DigitalIn) + sizeof(mbed::DigitalIn*) + sizeof(DataReadyTicker) + sizeof(mbed::Callback<void()>);
+#endif
+    return size;
+  }
+
+private:
+
+#if DEVICE_LPTICKER
+  typedef mbed::LowPowerTicker DataReadyTicker;
+#else
+  typedef mbed::Ticker DataReadyTicker;
+#endif
+
+  static DataReadyTicker& dataReadyTicker() {
+    static DataReadyTicker ticker;
+    return ticker;
+  }
+
+  static mbed::DigitalIn*& dataReadyLine() {
+    static mbed::DigitalIn* line = nullptr;
+    return line;
+  }
+
+  static mbed::Callback<void()>& dataReadyFunc() {
+    static mbed::Callback<void()> func;
+    return func;
+  }
+
+  static void sampleDataReady() {
+    if (dataReadyLine()->read()) {
+      dataReadyFunc()();
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,3 @@
+#include "ESPHostEMACTrace_impl.h"
+
+template class ESPHostEMACTraceBase<ESPHostEMACConfig>;
@@ -0,0 +1,115 @@
+#ifndef ESPHOST_EMAC_TRACE_H_
+#define ESPHOST_EMAC_TRACE_H_
+
+#include <stdint.h>
+#include "Arduino.h"
+#include "mbed.h"
+#include "rtos.h"
+#include "ESPHostEMAC_config.h"
+
+/** ESPHostEMACTraceBase class template
+ *  Records the calls of ESPHostEMAC to ESPHost (communicateWithEsp, peekStationRxMsgSize,
+ *  getStationRx and sendBuffer) with their timing and the RX buffer allocations,
+ *  for replay with extras/host/replay.
+ *
+ *  Binary format written by write(), all values little endian:
+ *  header: "ESPT", uint16 version, uint16 record size, uint32 record count
+ *  record: uint32 start time [us], uint16 duration [us], uint16 length, uint8 call, int8 result,
+ *          Config::trace_snaplen bytes of the frame
+ *
+ *  The low nibble of call is the Call, the high nibble is the ESPHostInterface.
+ *  The length is the returned size for PEEK_RX, the frame length for GET_RX and SEND
+ *  and the requested size for ALLOC. The result is the error code of sendBuffer and
+ *  -1 for a failed ALLOC. The frame bytes are recorded for GET_RX and SEND and are
+ *  zero for the other calls and beyond the frame. The duration saturates at 65535 us.
+ *  Version 1 records have no frame bytes and no ALLOC.
+ *
+ *  Config is the Config of the EMAC the trace is set on.
+ */
+template<class Config = ESPHostEMACConfig>
+class ESPHostEMACTraceBase {
+public:
+
+  enum Call {
+    COMMUNICATE = 1,
+    PEEK_RX = 2,
+    GET_RX = 3,
+    SEND = 4,
+    ALLOC = 5
+  };
+
+  ESPHostEMACTraceBase();
+
+  /** Start recording */
+  void start();
+
+  /** Stop recording */
+  void stop();
+
+  /** Remove all recorded calls */
+  void clear();
+
+  /** Return the count of recorded calls
+   *
+   * @return     count of recorded calls
+   */
+  uint32_t get_count() const;
+
+  /** Return the count of calls not recorded because the buffer was full
+   *
+   * @return     count of missed calls
+   */
+  uint32_t get_overflow_count() const;
+
+  /** Write the recorded calls in the binary trace format
+   *
+   * @param out  Stream to write to (Serial, a client, a file)
+   * @return     number of records written
+   */
+  size_t write(arduino::Print &out);
+
+  /** Return the current time for record(). Called by the EMAC.
+   *
+   * @return     time in microseconds
+   */
+  uint32_t now() const {
+    return us_ticker_read();
+  }
+
+  /** Record a call. Called by the EMAC.
+   *
+   * @param call    The recorded call
+   * @param iface   The interface of the call
+   * @param start   Time the call started, from now()
+   * @param len     Length of the data
+   * @param result  Result of the call
+   * @param frame   Frame of GET_RX and SEND, NULL for the other calls
+   */
+  void record(Call call, uint8_t iface, uint32_t start, uint16_t len, int result, const uint8_t *frame = NULL);
+
+private:
+  static void write16(arduino::Print &out, uint16_t v);
+  static void write32(arduino::Print &out, uint32_t v);
+
+  struct Record {
+    uint32_t start;
+    uint16_t duration;
+    uint16_t len;
+    uint8_t call;
+    int8_t result;
+    uint8_t frame[Config::trace_snaplen];
+  };
+
+  Record buffer[Config::trace_buffer_size];
+  uint32_t count;
+  uint32_t overflowCount;
+  volatile bool running;
+  rtos::Mutex mutex;
+};
+
+typedef ESPHostEMACTraceBase<> ESPHostEMACTrace;
+
+// instantiated in ESPHostEMACTrace.cpp, include ESPHostEMACTrace_impl.h for another Config
+extern template class ESPHostEMACTraceBase<ESPHostEMACConfig>;
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef ESPHOST_EMAC_TRACE_IMPL_H_
+#define ESPHOST_EMAC_TRACE_IMPL_H_
+
+// ESPHostEMACTraceBase member definitions. Included by ESPHostEMACTrace.cpp for
+// ESPHostEMACConfig and by code which uses an EMAC with another Config.
+
+#include "ESPHostEMACTrace.h"
+
+#define TRACE_VERSION       2
+#define TRACE_RECORD_SIZE   (10 + Config::trace_snaplen)
+
+template<class Config>
+void ESPHostEMACTraceBase<Config>::write16(arduino::Print &out, uint16_t v) {
+  uint8_t b[2] = {(uint8_t) v, (uint8_t) (v >> 8)};
+  out.write(b, sizeof(b));
+}
+
+template<class Config>
+void ESPHostEMACTraceBase<Config>::write32(arduino::Print &out, uint32_t v) {
+  uint8_t b[4] = {(uint8_t) v, (uint8_t) (v >> 8), (uint8_t) (v >> 16), (uint8_t) (v >> 24)};
+  out.write(b, sizeof(b));
+}
+
+template<class Config>
+ESPHostEMACTraceBase<Config>::ESPHostEMACTraceBase() :
+    count(0), overflowCount(0), running(false) {
+
+}
+
+template<class Config>
+void ESPHostEMACTraceBase<Config>::start() {
+  running = true;
+}
+
+template<class Config>
+void ESPHostEMACTraceBase<Config>::stop() {
+  running = false;
+}
+
+template<class Config>
+void ESPHostEMACTraceBase<Config>::clear() {
+  mutex.lock();
+  count = 0;
+  overflowCount = 0;
+  mutex.unlock();
+}
+
+template<class Config>
+uint32_t ESPHostEMACTraceBase<Config>::get_count() const {
+  return count;
+}
+
+template<class Config>
+uint32_t ESPHostEMACTraceBase<Config>::get_overflow_count() const {
+  return overflowCount;
+}
+
+template<class Config>
+void ESPHostEMACTraceBase<Config>::record(Call call, uint8_t iface, uint32_t start, uint16_t len, int result, const uint8_t *frame) {
+  if (!running)
+    return;
+  uint32_t duration = us_ticker_read() - start;
+
+  mutex.lock();
+  if (count < Config::trace_buffer_size) {
+    Record &r = buffer[count];
+    r.start = start;
+    r.duration = (duration > UINT16_MAX) ? UINT16_MAX : duration;
+    r.len = len;
+    r.call = call | (iface << 4);
+    r.result = result;
+    uint16_t caplen = 0;
+    if (frame) {
+      caplen = (len < Config::trace_snaplen) ? len : Config::trace_snaplen;
+      memcpy(r.frame, frame, caplen);
+    }
+    memset(r.frame + caplen, 0, sizeof(r.frame) - caplen);
+    count++;
+  } else {
+    overflowCount++;
+  }
+  mutex.unlock();
+}
+
+template<class Config>
+size_t ESPHostEMACTraceBase<Config>::write(arduino::Print &out) {
+  mutex.lock();
+  uint32_t n = count;
+  mutex.unlock();
+
+  out.write((const uint8_t*) "ESPT", 4);
+  write16(out, TRACE_VERSION);
+  write16(out, TRACE_RECORD_SIZE);
+  write32(out, n);
+  for (uint32_t i = 0; i < n; i++) { // recorded entries are not modified until clear()
+    const Record &r = buffer[i];
+    write32(out, r.start);
+    write16(out, r.duration);
+    write16(out, r.len);
+    out.write(r.call);
+    out.write((uint8_t) r.result);
+    out.write(r.frame, sizeof(r.frame));
+  }
+  return n;
+}
+
+#endif
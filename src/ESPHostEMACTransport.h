@@ -0,0 +1,59 @@
+#ifndef ESPHOST_EMAC_TRANSPORT_H_
+#define ESPHOST_EMAC_TRANSPORT_H_
+
+#include <stdint.h>
+#include "CEspControl.h"
+#include "ESPHostEMAC_config.h"
+#include "ESPHostEMACPlatform.h"
+
+/** ESPHostTransport
+ *  Transport policy of ESPHostEMACBase for the ESPHost library.
+ *
+ *  A transport for ESPHostEMACBase provides the same static functions.
+ *  They are called with the EMAC mutex locked, except peek_rx.
+ *  The platform types and functions come from ESPHostMbedPlatform.
+ */
+struct ESPHostTransport : ESPHostMbedPlatform {
+
+  static constexpr int OK = ESP_CONTROL_OK;
+
+  /** Exchange the queued messages and frames with the co-processor */
+  static void communicate() {
+    CEspControl::getInstance().communicateWithEsp();
+  }
+
+  /** Return the size of the next received frame of the interface, 0 if none */
+  static uint16_t peek_rx(ESPHostInterface iface) {
+    return (iface == ESPHOST_SOFT_AP)
+        ? CEspControl::getInstance().peekSoftApRxMsgSize()
+        : CEspControl::getInstance().peekStationRxMsgSize();
+  }
+
+  /** Copy the next received frame of the interface into data */
+  static void get_rx(ESPHostInterface iface, uint8_t *data, uint16_t size) {
+    uint8_t if_num = 0;
+    if (iface == ESPHOST_SOFT_AP) {
+      CEspControl::getInstance().getSoftApRx(if_num, data, size);
+    } else {
+      CEspControl::getInstance().getStationRx(if_num, data, size);
+    }
+  }
+
+  /** Send a frame over the interface, returns OK on success */
+  static int send(ESPHostInterface iface, uint8_t *data, uint16_t len) {
+    uint8_t ifn = 0;
+    return CEspControl::getInstance().sendBuffer((iface == ESPHOST_SOFT_AP) ? ESP_AP_IF : ESP_STA_IF, ifn, data, len);
+  }
+
+  /** Read the MAC address of the interface, returns true on success */
+  static bool get_hwaddr(ESPHostInterface iface, uint8_t *addr) {
+    WifiMac_t MAC;
+    MAC.mode = (iface == ESPHOST_SOFT_AP) ? WIFI_MODE_AP : WIFI_MODE_STA;
+    if (CEspControl::getInstance().getWifiMacAddress(MAC) != ESP_CONTROL_OK)
+      return false;
+    CNetUtilities::macStr2macArray(addr, MAC.mac);
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "ESPHostEMAC_config.h"
+
+constexpr uint8_t ESPHostEMACConfig::hwaddr_size;
+constexpr uint32_t ESPHostEMACConfig::buff_alignment;
+constexpr uint32_t ESPHostEMACConfig::mtu_size;
+constexpr char ESPHostEMACConfig::wifi_if_name[];
+constexpr char ESPHostEMACConfig::softap_if_name[];
+constexpr uint16_t ESPHostEMACConfig::eth_header_size;
+constexpr uint16_t ESPHostEMACConfig::eth_type_offset;
+constexpr std::chrono::milliseconds ESPHostEMACConfig::receive_task_period;
+constexpr uint8_t ESPHostEMACConfig::receive_idle_runs;
+constexpr std::chrono::milliseconds ESPHostEMACConfig::data_ready_poll;
+constexpr std::chrono::milliseconds ESPHostEMACConfig::low_latency_period;
+constexpr std::chrono::milliseconds ESPHostEMACConfig::low_power_idle_period;
+constexpr uint8_t ESPHostEMACConfig::rx_burst;
+constexpr uint8_t ESPHostEMACConfig::rx_pause_headroom;
+constexpr uint8_t ESPHostEMACConfig::rx_resume_headroom;
+constexpr std::chrono::milliseconds ESPHostEMACConfig::rx_pause_max;
+constexpr uint8_t ESPHostEMACConfig::rx_pause_tx_exchanges;
+constexpr uint8_t ESPHostEMACConfig::raw_handlers_max;
+constexpr uint16_t ESPHostEMACConfig::capture_snaplen;
+constexpr uint16_t ESPHostEMACConfig::capture_ring_size;
+constexpr std::chrono::milliseconds ESPHostEMACConfig::health_timeout;
+constexpr uint8_t ESPHostEMACConfig::health_tx_error_limit;
+constexpr uint32_t ESPHostEMACConfig::worker_stack_size;
+constexpr std::chrono::milliseconds ESPHostEMACConfig::reset_pulse;
+constexpr std::chrono::milliseconds ESPHostEMACConfig::adopt_wait;
+constexpr uint8_t ESPHostEMACConfig::softap_max_connections;
+constexpr uint16_t ESPHostEMACConfig::trace_buffer_size;
+constexpr uint8_t ESPHostEMACConfig::trace_snaplen;
+constexpr bool ESPHostEMACConfig::static_alloc;
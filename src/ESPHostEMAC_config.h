@@ -1,11 +1,82 @@
 #ifndef ESPHOST_EMAC_CONFIG_H_
 #define ESPHOST_EMAC_CONFIG_H_
 
-#define ESPHOST_HWADDR_SIZE                 6U
-#define ESPHOST_BUFF_ALIGNMENT              4U
-#define ESPHOST_WIFI_MTU_SIZE               1500U
-#define ESPHOST_WIFI_IF_NAME                "ESPHOST"
+#include <stdint.h>
+#include <chrono>
 
-#define ESPHOST_RECEIVE_TASK_PERIOD_MS       20ms
+// build with ESPHOST_STATIC_ALLOC=1 for the static allocation mode
+#ifndef ESPHOST_STATIC_ALLOC
+#define ESPHOST_STATIC_ALLOC 0
+#endif
+
+// build with ESPHOST_DATA_READY_PIN set to the data-ready line of the ESP to wake
+// the idle receive task when the ESP has data, else the ESP is only polled. The
+// line is sampled every ESPHostEMACConfig::data_ready_poll, no interrupt is attached
+// to it, because the pin belongs to ESPHost.
+
+// build with ESPHOST_RESET_PIN set to the reset (EN) line of the ESP for the recovery
+// of a not responding ESP. It defaults to NINA_RESETN of the variant (Nano RP2040 Connect).
+// Without it the watchdog isn't armed, with a compiler warning and a debug warning at connect.
+
+/** Wi-Fi interfaces of the ESP */
+enum ESPHostInterface {
+  ESPHOST_STATION = 0,
+  ESPHOST_SOFT_AP = 1,
+  ESPHOST_INTERFACE_COUNT
+};
+
+/** Compile-time configuration of ESPHostEMACBase
+ *
+ *  Another configuration can be used as the Config parameter of ESPHostEMACBase.
+ *  It must provide the same constants.
+ */
+struct ESPHostEMACConfig {
+  static constexpr uint8_t hwaddr_size = 6;
+  static constexpr uint32_t buff_alignment = 4;
+  static constexpr uint32_t mtu_size = 1500;
+  static constexpr char wifi_if_name[] = "ESPHOST";
+  static constexpr char softap_if_name[] = "ESPHOSTAP";
+  static constexpr uint16_t eth_header_size = 14;
+  static constexpr uint16_t eth_type_offset = 12;
+
+  static constexpr std::chrono::milliseconds receive_task_period{20};
+  static constexpr uint8_t receive_idle_runs = 5; // receive task runs without traffic to switch to the idle period
+  static constexpr std::chrono::milliseconds data_ready_poll{10}; // sampling of the data-ready line, without SPI
+
+  // latency profiles of ESPHostEMACInterface
+  static constexpr std::chrono::milliseconds low_latency_period{5};
+  static constexpr std::chrono::milliseconds low_power_idle_period{200};
+
+  // RX flow control
+  static constexpr uint8_t rx_burst = 4;            // max frames handed to the stack per receive task run
+  static constexpr uint8_t rx_pause_headroom = 1;   // MTU sized buffers which must be free to read a burst after a pause, else RX pauses again
+  static constexpr uint8_t rx_resume_headroom = 1;  // MTU sized buffers which must be free to resume RX, more for a hysteresis on a large heap
+  static constexpr std::chrono::milliseconds rx_pause_max{100}; // after this time a pause ends without the headroom
+  static constexpr uint8_t rx_pause_tx_exchanges = 2; // exchanges to send while RX is paused or received frames wait in ESPHost
+
+  // raw Layer-2 EtherType handlers
+  static constexpr uint8_t raw_handlers_max = 4;
+
+  // packet capture
+  static constexpr uint16_t capture_snaplen = 64;   // captured bytes of a frame
+  static constexpr uint16_t capture_ring_size = 32; // captured frames kept, oldest are overwritten
+
+  // SPI link health watchdog
+  static constexpr std::chrono::milliseconds health_timeout{10000}; // without a successful exchange the ESP is probed
+  static constexpr uint8_t health_tx_error_limit = 8;               // failed sends in a row to reset the ESP
+  static constexpr uint32_t worker_stack_size = 2048;               // stack of the worker thread which runs the recovery
+  static constexpr std::chrono::milliseconds reset_pulse{10};       // pulse on the reset line of ESPHostEMACInterface
+  static constexpr std::chrono::milliseconds adopt_wait{200};       // for the init event before an ESP running over a reset of the MCU is probed
+
+  // SoftAP of WhdSoftAPInterface
+  static constexpr uint8_t softap_max_connections = 4;
+
+  // ESPHost call trace
+  static constexpr uint16_t trace_buffer_size = 256; // recorded calls, recording stops when full
+  static constexpr uint8_t trace_snaplen = 14;       // recorded bytes of a frame, the Ethernet header
+
+  // static allocation mode: RX frames from the memory pool, TX staged in a static buffer
+  static constexpr bool static_alloc = ESPHOST_STATIC_ALLOC;
+};
 
 #endif
@@ -0,0 +1,1032 @@
+#ifndef ESPHOST_EMAC_IMPL_H_
+#define ESPHOST_EMAC_IMPL_H_
+
+// ESPHostEMACBase member definitions. Included by ESPHostEMAC.cpp for the ESPHost
+// transport and by code which instantiates ESPHostEMACBase with another transport.
+
+#include "ESPHostEMACBase.h"
+#include "ESPHostEMACCapture_impl.h"
+#include "ESPHostEMACTrace_impl.h"
+
+template<class Transport, class Config>
+ESPHostEMACBase<Transport, Config>* ESPHostEMACBase<Transport, Config>::poweredUp[ESPHOST_INTERFACE_COUNT];
+template<class Transport, class Config>
+int ESPHostEMACBase<Transport, Config>::receiveTaskHandle = 0;
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::receiveTaskActive = false;
+template<class Transport, class Config>
+volatile bool ESPHostEMACBase<Transport, Config>::dataReadyPending = false;
+template<class Transport, class Config>
+volatile bool ESPHostEMACBase<Transport, Config>::txActivity = false;
+template<class Transport, class Config>
+uint8_t ESPHostEMACBase<Transport, Config>::txExchanges = 0;
+template<class Transport, class Config>
+uint8_t ESPHostEMACBase<Transport, Config>::idleRuns = 0;
+template<class Transport, class Config>
+uint32_t ESPHostEMACBase<Transport, Config>::wakeupCount = 0;
+template<class Transport, class Config>
+std::chrono::milliseconds ESPHostEMACBase<Transport, Config>::activePeriod = Config::receive_task_period;
+template<class Transport, class Config>
+std::chrono::milliseconds ESPHostEMACBase<Transport, Config>::idlePeriod = Config::receive_task_period;
+template<class Transport, class Config>
+typename Transport::Clock::time_point ESPHostEMACBase<Transport, Config>::lastExchange;
+template<class Transport, class Config>
+uint8_t ESPHostEMACBase<Transport, Config>::txErrorStreak = 0;
+template<class Transport, class Config>
+mbed::Callback<bool()> ESPHostEMACBase<Transport, Config>::recoveryCb;
+template<class Transport, class Config>
+volatile bool ESPHostEMACBase<Transport, Config>::recovering = false;
+template<class Transport, class Config>
+uint32_t ESPHostEMACBase<Transport, Config>::datapathHeapAllocs = 0;
+template<class Transport, class Config>
+alignas(8) unsigned char ESPHostEMACBase<Transport, Config>::workerStack[Config::worker_stack_size];
+template<class Transport, class Config>
+uint8_t ESPHostEMACBase<Transport, Config>::instanceCount = 0;
+template<class Transport, class Config>
+alignas(Config::buff_alignment) uint8_t ESPHostEMACBase<Transport, Config>::rawRxBuffer[Config::mtu_size + Config::eth_header_size];
+template<class Transport, class Config>
+ESPHostEMACBase<Transport, Config>* ESPHostEMACBase<Transport, Config>::rawRxHeld = NULL;
+template<class Transport, class Config>
+uint16_t ESPHostEMACBase<Transport, Config>::rawRxHeldSize = 0;
+template<class Transport, class Config>
+alignas(Config::buff_alignment) uint8_t ESPHostEMACBase<Transport, Config>::txBuffer[Config::static_alloc ? Config::mtu_size + Config::eth_header_size : 1];
+template<class Transport, class Config>
+ESPHostEMACTraceBase<Config>* ESPHostEMACBase<Transport, Config>::trace = NULL;
+template<class Transport, class Config>
+typename Transport::Mutex ESPHostEMACBase<Transport, Config>::wifiLockMutex;
+
+template<class Transport, class Config>
+ESPHostEMACBase<Transport, Config>::ESPHostEMACBase(ESPHostInterface iface) :
+    iface(iface), rxPaused(false), rxPauseCount(0),
+    rxFrames(0), rxBytes(0), txFrames(0), txBytes(0), txErrors(0), rawHandlerCount(0),
+    memoryManager(NULL), capture(NULL) {
+  instanceCount++;
+}
+
+/** Return the EMAC of the station interface
+ * Returns the default on-board EMAC - this will be target-specific, and
+ * may not be available on all targets.
+ */
+template<class Transport, class Config>
+ESPHostEMACBase<Transport, Config>& ESPHostEMACBase<Transport, Config>::get_instance(void) {
+  static ESPHostEMACBase emac(ESPHOST_STATION);
+  return emac;
+}
+
+/** Return the EMAC of the SoftAP interface
+ */
+template<class Transport, class Config>
+ESPHostEMACBase<Transport, Config>& ESPHostEMACBase<Transport, Config>::get_softap_instance(void) {
+  static ESPHostEMACBase emac(ESPHOST_SOFT_AP);
+  return emac;
+}
+
+/**
+ * Return maximum transmission unit
+ *
+ * @return     MTU in bytes
+ */
+template<class Transport, class Config>
+uint32_t ESPHostEMACBase<Transport, Config>::get_mtu_size(void) const {
+  return Config::mtu_size;
+}
+
+/**
+ * Gets memory buffer alignment preference
+ *
+ * Gets preferred memory buffer alignment of the Emac device. IP stack may
+ * or may not align link out memory buffer chains using the alignment.
+ *
+ * @return         Memory alignment requirement in bytes
+ */
+template<class Transport, class Config>
+uint32_t ESPHostEMACBase<Transport, Config>::get_align_preference(void) const {
+  return Config::buff_alignment;
+}
+
+/**
+ * Return interface name
+ *
+ * @param name Pointer to where the name should be written
+ * @param size Maximum number of character to copy
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::get_ifname(char *name, uint8_t size) const {
+  if (iface == ESPHOST_SOFT_AP) {
+    memcpy(name, Config::softap_if_name, (size < sizeof(Config::softap_if_name)) ? size : sizeof(Config::softap_if_name));
+  } else {
+    memcpy(name, Config::wifi_if_name, (size < sizeof(Config::wifi_if_name)) ? size : sizeof(Config::wifi_if_name));
+  }
+}
+
+/**
+ * Returns size of the underlying interface HW address size.
+ *
+ * @return     HW address size in bytes
+ */
+template<class Transport, class Config>
+uint8_t ESPHostEMACBase<Transport, Config>::get_hwaddr_size(void) const {
+  return Config::hwaddr_size;
+}
+
+/**
+ * Return interface-supplied HW address
+ *
+ * Copies HW address to provided memory, @param addr has to be of correct
+ * size see @a get_hwaddr_size
+ *
+ * HW address need not be provided if this interface does not have its own
+ * HW address configuration; stack will choose address from central system
+ * configuration if the function returns false and does not write to addr.
+ *
+ * @param addr HW address for underlying interface
+ * @return     true if HW address is available
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::get_hwaddr(uint8_t *addr) const {
+  wifiLockMutex.lock();
+  bool ok = Transport::get_hwaddr(iface, addr);
+  wifiLockMutex.unlock();
+  return ok;
+}
+
+/**
+ * Set HW address for interface
+ *
+ * Provided address has to be of correct size, see @a get_hwaddr_size
+ *
+ * Called to set the MAC address to actually use - if @a get_hwaddr is
+ * provided the stack would normally use that, but it could be overridden,
+ * eg for test purposes.
+ *
+ * @param addr Address to be set
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_hwaddr(const uint8_t *addr) {
+//  WifiMac_t MAC;
+//  MAC.mode = WIFI_MODE_STA;
+//  CNetUtilities::macArray2macStr(MAC.mac, addr);
+//  CEspControl::getInstance().setWifiMacAddress(MAC);
+}
+
+/**
+ * Initializes the HW
+ *
+ * @return True on success, False in case of an error.
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::power_up(void) {
+
+  rxPaused = false;
+  rxPauseCount = 0;
+  rxFrames = 0;
+  rxBytes = 0;
+  txFrames = 0;
+  txBytes = 0;
+  txErrors = 0;
+
+  /* Trigger thread to deal with any RX packets that arrived
+   * before receiver_thread was started */
+  wifiLockMutex.lock();
+  bool running = false;
+  for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+    running |= (poweredUp[i] != NULL);
+  }
+  poweredUp[iface] = this;
+  idleRuns = 0;
+  if (!running) {
+    wakeupCount = 0;
+    datapathHeapAllocs = 0;
+    txExchanges = 0;
+    txErrorStreak = 0;
+    lastExchange = Transport::Clock::now();
+    Transport::attach_data_ready(mbed::callback(&ESPHostEMACBase<Transport, Config>::dataReady), Config::data_ready_poll);
+  }
+  // a receive task which couldn't be canceled by power_down continues its chain,
+  // a recovery starts it when it ends
+  if (!receiveTaskActive && !recovering) {
+    receiveTaskActive = true;
+    receiveTaskHandle = Transport::call(mbed::callback(&ESPHostEMACBase<Transport, Config>::receiveTask));
+  }
+  wifiLockMutex.unlock();
+
+  if (emac_link_state_cb) {
+    emac_link_state_cb(true);
+  }
+  return true;
+}
+
+/**
+ * Deinitializes the HW
+ *
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::power_down(void) {
+  wifiLockMutex.lock();
+  poweredUp[iface] = NULL;
+  if (rawRxHeld == this) { // the held frame is dropped
+    rawRxHeld = NULL;
+  }
+  bool running = false;
+  for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+    running |= (poweredUp[i] != NULL);
+  }
+  if (!running) {
+    Transport::attach_data_ready(mbed::Callback<void()>(), Config::data_ready_poll);
+    if (Transport::cancel(receiveTaskHandle)) { // else it runs now and ends the chain or continues it after a power_up
+      receiveTaskActive = false;
+    }
+  }
+  wifiLockMutex.unlock();
+}
+
+/**
+ * Sends the packet over the link
+ *
+ * That can not be called from an interrupt context.
+ *
+ * @param buf  Packet to be send
+ * @return     True if the packet was send successfully, False otherwise
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::link_out(emac_mem_buf_t *buf) {
+  if (buf == NULL)
+    return false;
+  if (recovering) { // don't wait for the probe or the reset of the ESP
+    memoryManager->free(buf);
+    txErrors++;
+    return false;
+  }
+
+  // If buffer is chained or not aligned then make a contiguous aligned copy of it
+  if (memoryManager->get_next(buf) || reinterpret_cast<uintptr_t>(memoryManager->get_ptr(buf)) % Config::buff_alignment) {
+    if (Config::static_alloc)
+      return linkOutStaged(buf);
+    emac_mem_buf_t* copy_buf;
+    copy_buf = memoryManager->alloc_heap(memoryManager->get_total_len(buf), Config::buff_alignment);
+    if (NULL == copy_buf) {
+      memoryManager->free(buf);
+      txErrors++;
+      return false;
+    }
+    datapathHeapAllocs++;
+
+    // Copy to new buffer and free original
+    memoryManager->copy(copy_buf, buf);
+    memoryManager->free(buf);
+    buf = copy_buf;
+  }
+  wifiLockMutex.lock();
+  uint16_t len = memoryManager->get_len(buf);
+  uint8_t* data = (uint8_t*) (memoryManager->get_ptr(buf));
+  int error = espSend(data, len);
+  wifiLockMutex.unlock();
+  memoryManager->free(buf);
+  wakeReceiveTask();
+
+  return (error == Transport::OK);
+}
+
+/*
+ * Static allocation mode. A chained or unaligned packet is copied
+ * into the static txBuffer instead of an aligned heap buffer.
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::linkOutStaged(emac_mem_buf_t *buf) {
+  wifiLockMutex.lock();
+  uint16_t len = memoryManager->copy_from_buf(txBuffer, sizeof(txBuffer), buf);
+  memoryManager->free(buf);
+  int error = espSend(txBuffer, len);
+  wifiLockMutex.unlock();
+  wakeReceiveTask();
+
+  return (error == Transport::OK);
+}
+
+/*
+ * One SPI servicing run for all interfaces. The frames received by ESPHost
+ * are demultiplexed to the EMAC of their interface.
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::receiveTask() {
+  wakeupCount++;
+
+  bool activity = txActivity;
+  txActivity = false;
+
+  wifiLockMutex.lock();
+  ESPHostEMACBase* emacs[ESPHOST_INTERFACE_COUNT];
+  memcpy(emacs, poweredUp, sizeof(emacs));
+  bool rxWaiting = false;
+  for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+    rxWaiting |= (emacs[i] && (emacs[i]->rxPaused || Transport::peek_rx(emacs[i]->iface)));
+  }
+  // while RX is paused or frames read before still wait in ESPHost, the ESP is
+  // serviced only to send, so the received frames wait in the ESP and don't
+  // pile up in the ESPHost queue on the MCU heap. An exchange to send moves the
+  // frames the ESP has ready too, so there are at most Config::rx_pause_tx_exchanges
+  // of them until the ESPHost queue is empty again. That bounds the ESPHost queue
+  // to 1 + rx_pause_tx_exchanges times the RX queue of the ESP. Meanwhile frames
+  // to send wait in the TX queue of ESPHost, which refuses them when it is full.
+  if (!rxWaiting) {
+    txExchanges = 0;
+    espCommunicate();
+  } else if (activity && txExchanges < Config::rx_pause_tx_exchanges) {
+    txExchanges++;
+    espCommunicate();
+  }
+  wifiLockMutex.unlock();
+
+  for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+    if (emacs[i] && emacs[i]->receiveFrames()) {
+      activity = true;
+    }
+  }
+  if (checkHealth())
+    return; // the probe or the recovery starts the receive task again
+  scheduleReceiveTask(activity);
+}
+
+/*
+ * SPI link health watchdog. A received frame or a successful send is a successful
+ * exchange with the ESP. Without one for Config::health_timeout or after too many
+ * failed sends in a row the ESP is probed in the worker thread, see recoveryTask.
+ * Returns true if the probe started, the chain of the receive task then ends.
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::checkHealth() {
+  if (!recoveryCb)
+    return false;
+  if (txErrorStreak < Config::health_tx_error_limit && Transport::Clock::now() - lastExchange < Config::health_timeout)
+    return false;
+
+  wifiLockMutex.lock();
+  recovering = true;
+  receiveTaskActive = false;
+  wifiLockMutex.unlock();
+  Transport::call_worker(mbed::callback(&ESPHostEMACBase<Transport, Config>::recoveryTask), workerStack, sizeof(workerStack));
+  return true;
+}
+
+/*
+ * Runs in the worker thread, so the probe, the reset of the ESP and the rejoin
+ * don't block the event queue. The probe is a control request. It holds the mutex,
+ * like every ESPHost call, and waits for the control timeout if the ESP doesn't
+ * respond, but meanwhile the receive task is stopped and sending fails immediately,
+ * so nothing on the datapath waits for the mutex. Sends also fail if the TX queue
+ * of the ESP is full, so only a failed probe reports the links down and resets
+ * the ESP. After a successful reset each powered up interface is restored with
+ * its restore function and only then its link is reported up.
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::recoveryTask() {
+  uint8_t addr[Config::hwaddr_size];
+  wifiLockMutex.lock();
+  bool responding = Transport::get_hwaddr(ESPHOST_STATION, addr);
+  ESPHostEMACBase* emacs[ESPHOST_INTERFACE_COUNT];
+  memcpy(emacs, poweredUp, sizeof(emacs));
+  wifiLockMutex.unlock();
+
+  bool restored[ESPHOST_INTERFACE_COUNT] = {};
+  if (!responding) {
+    for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+      if (emacs[i] && emacs[i]->emac_link_state_cb) {
+        emacs[i]->emac_link_state_cb(false);
+      }
+    }
+    bool recovered = recoveryCb();
+    wifiLockMutex.lock();
+    memcpy(emacs, poweredUp, sizeof(emacs));
+    wifiLockMutex.unlock();
+    for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+      restored[i] = recovered && emacs[i] && emacs[i]->restoreCb && emacs[i]->restoreCb();
+    }
+  }
+
+  wifiLockMutex.lock();
+  recovering = false;
+  txErrorStreak = 0;
+  lastExchange = Transport::Clock::now();
+  idleRuns = 0;
+  bool running = false;
+  for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+    running |= (poweredUp[i] != NULL);
+  }
+  if (running && !receiveTaskActive) {
+    receiveTaskActive = true;
+    receiveTaskHandle = Transport::call(mbed::callback(&ESPHostEMACBase<Transport, Config>::receiveTask));
+  }
+  wifiLockMutex.unlock();
+
+  for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+    if (restored[i] && emacs[i]->emac_link_state_cb) {
+      emacs[i]->emac_link_state_cb(true);
+    }
+  }
+}
+
+/*
+ * Hands up to Config::rx_burst received frames of the interface to the stack.
+ * Returns true if there was a frame or RX is paused.
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::receiveFrames() {
+  bool resumed = rxPaused;
+  if (rxPaused && !rxFlowResume())
+    return true; // stay on the active period to resume soon
+  if (rawRxHeld == this) {
+    emac_mem_buf_t* payload = heldInput();
+    if (payload == NULL)
+      return true;
+    stackInput(payload);
+  } else if (rawRxHeld) {
+    return true; // rawRxBuffer is in use, wait for the memory like the other interface
+  }
+
+  bool received = false;
+  for (unsigned i = 0; i < Config::rx_burst; i++) {
+    uint16_t size = espPeekRx();
+    if (size == 0)
+      break;
+    received = true;
+    if (i == 0 && !resumed && rxPauseCount && Transport::Clock::now() - rxResumeTime < Config::rx_pause_max
+        && !hasHeadroom(Config::rx_pause_headroom)) {
+      rxFlowPause();
+      break;
+    }
+    emac_mem_buf_t* payload;
+    if (rawHandlerCount) {
+      if (rawInput(size))
+        continue;
+      payload = heldInput();
+    } else {
+      payload = lowLevelInput(size);
+    }
+    if (payload == NULL)
+      break;
+    stackInput(payload);
+  }
+  return received;
+}
+
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::stackInput(emac_mem_buf_t *buf) {
+  if (emac_link_input_cb) {
+    emac_link_input_cb(buf);
+  } else {
+    memoryManager->free(buf);
+  }
+}
+
+/*
+ * The receive task reschedules itself with the active period while there is
+ * traffic and with the idle period after Config::receive_idle_runs runs without it.
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::scheduleReceiveTask(bool activity) {
+  wifiLockMutex.lock();
+  if (activity) {
+    idleRuns = 0;
+  } else if (idleRuns < Config::receive_idle_runs) {
+    idleRuns++;
+  }
+  bool running = false;
+  for (unsigned i = 0; i < ESPHOST_INTERFACE_COUNT; i++) {
+    running |= (poweredUp[i] != NULL);
+  }
+  if (running) {
+    std::chrono::milliseconds period = (idleRuns < Config::receive_idle_runs) ? activePeriod : idlePeriod;
+    receiveTaskHandle = Transport::call_in(period, mbed::callback(&ESPHostEMACBase<Transport, Config>::receiveTask));
+  } else {
+    receiveTaskActive = false;
+  }
+  wifiLockMutex.unlock();
+}
+
+/*
+ * Called after TX.
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::wakeReceiveTask() {
+  txActivity = true;
+  runReceiveTaskNow();
+}
+
+/*
+ * If the receive task waits with the idle period, it is run immediately
+ * so the ESP is serviced without the idle delay.
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::runReceiveTaskNow() {
+  if (activePeriod == idlePeriod)
+    return;
+  wifiLockMutex.lock();
+  if (idleRuns >= Config::receive_idle_runs && receiveTaskActive) {
+    idleRuns = 0;
+    if (Transport::cancel(receiveTaskHandle)) { // else it runs now and reschedules itself
+      receiveTaskHandle = Transport::call(mbed::callback(&ESPHostEMACBase<Transport, Config>::receiveTask));
+    }
+  }
+  wifiLockMutex.unlock();
+}
+
+/*
+ * Data-ready interrupt of the ESP. The mutex can't be locked in the interrupt,
+ * so an idle receive task is woken from the event queue.
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::dataReady() {
+  if (dataReadyPending || idleRuns < Config::receive_idle_runs || activePeriod == idlePeriod)
+    return;
+  dataReadyPending = true;
+  Transport::call(mbed::callback(&ESPHostEMACBase<Transport, Config>::dataReadyWake));
+}
+
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::dataReadyWake() {
+  dataReadyPending = false;
+  runReceiveTaskNow();
+}
+
+/*
+ * RX flow control. The frames waiting in the stack hold their memory, so the free
+ * memory drops with the backlog of the stack. RX pauses if a frame can't be
+ * allocated. The frames then stay queued in the ESP instead of being pulled and
+ * dropped. RX resumes if Config::rx_resume_headroom buffers can be allocated, or
+ * after Config::rx_pause_max with the next frame, so a heap too small for the
+ * headroom slows RX down but doesn't stop it. For Config::rx_pause_max after a
+ * pause RX pauses again before a burst if fewer than Config::rx_pause_headroom
+ * MTU sized buffers can be allocated. The memory manager doesn't report its free
+ * memory, so the headroom is probed, but only under memory pressure.
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::rxFlowResume() {
+  if (Transport::Clock::now() - rxPauseStart < Config::rx_pause_max && !hasHeadroom(Config::rx_resume_headroom))
+    return false;
+  rxPaused = false;
+  rxResumeTime = Transport::Clock::now();
+  return true;
+}
+
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::rxFlowPause() {
+  rxPaused = true;
+  rxPauseStart = Transport::Clock::now();
+  rxPauseCount++;
+}
+
+/*
+ * Checks if the frames can be allocated by allocating and freeing them.
+ * The frames are allocated separately, so a fragmented heap is measured right.
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::hasHeadroom(uint8_t frames) {
+  static_assert(Config::rx_resume_headroom >= Config::rx_pause_headroom, "resume headroom below the pause headroom");
+  emac_mem_buf_t* probes[Config::rx_resume_headroom ? Config::rx_resume_headroom : 1];
+  uint8_t n = 0;
+  while (n < frames && n < Config::rx_resume_headroom) {
+    probes[n] = allocRx(Config::mtu_size + Config::eth_header_size);
+    if (probes[n] == nullptr)
+      break;
+    n++;
+  }
+  bool ok = (n == frames);
+  while (n) {
+    memoryManager->free(probes[--n]);
+  }
+  return ok;
+}
+
+template<class Transport, class Config>
+emac_mem_buf_t* ESPHostEMACBase<Transport, Config>::lowLevelInput(uint16_t size) {
+
+  emac_mem_buf_t* buf = allocRx(size);
+  if (buf == nullptr) { // leave the frame in ESPHost and pause RX
+    rxFlowPause();
+    return nullptr;
+  }
+  wifiLockMutex.lock();
+  if (memoryManager->get_next(buf)) { // a pool buffer can be a chain
+    espGetRx(rawRxBuffer, size);
+    memoryManager->copy_to_buf(buf, rawRxBuffer, size);
+  } else {
+    uint8_t* data = (uint8_t*) (memoryManager->get_ptr(buf));
+    espGetRx(data, size);
+  }
+  wifiLockMutex.unlock();
+  return buf;
+}
+
+/*
+ * RX buffers are allocated from the heap or with Config::static_alloc
+ * from the memory pool, which is sized at compile time. The allocations
+ * and their results are traced for the replay.
+ */
+template<class Transport, class Config>
+emac_mem_buf_t* ESPHostEMACBase<Transport, Config>::allocRx(uint32_t size) {
+  uint32_t start = trace ? trace->now() : 0;
+  emac_mem_buf_t* buf;
+  if (Config::static_alloc) {
+    buf = memoryManager->alloc_pool(size, Config::buff_alignment);
+  } else {
+    buf = memoryManager->alloc_heap(size, Config::buff_alignment);
+    if (buf) {
+      datapathHeapAllocs++;
+    }
+  }
+  if (trace) {
+    trace->record(ESPHostEMACTraceBase<Config>::ALLOC, iface, start, size, buf ? 0 : -1);
+  }
+  return buf;
+}
+
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::espCommunicate() {
+  uint32_t start = trace ? trace->now() : 0;
+  Transport::communicate();
+  if (trace) {
+    trace->record(ESPHostEMACTraceBase<Config>::COMMUNICATE, 0, start, 0, 0);
+  }
+}
+
+template<class Transport, class Config>
+uint16_t ESPHostEMACBase<Transport, Config>::espPeekRx() {
+  uint32_t start = trace ? trace->now() : 0;
+  uint16_t size = Transport::peek_rx(iface);
+  if (size) {
+    lastExchange = Transport::Clock::now();
+  }
+  if (trace) {
+    trace->record(ESPHostEMACTraceBase<Config>::PEEK_RX, iface, start, size, 0);
+  }
+  return size;
+}
+
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::espGetRx(uint8_t *data, uint16_t size) {
+  uint32_t start = trace ? trace->now() : 0;
+  Transport::get_rx(iface, data, size);
+  rxFrames++;
+  rxBytes += size;
+  if (trace) {
+    trace->record(ESPHostEMACTraceBase<Config>::GET_RX, iface, start, size, 0, data);
+  }
+  if (capture) {
+    capture->record(ESPHostEMACCaptureBase<Config>::RX, data, size);
+  }
+}
+
+template<class Transport, class Config>
+int ESPHostEMACBase<Transport, Config>::espSend(uint8_t *data, uint16_t len) {
+  if (capture) {
+    capture->record(ESPHostEMACCaptureBase<Config>::TX, data, len);
+  }
+  uint32_t start = trace ? trace->now() : 0;
+  int error = Transport::send(iface, data, len);
+  if (error == Transport::OK) {
+    txFrames++;
+    txBytes += len;
+    txErrorStreak = 0;
+    lastExchange = Transport::Clock::now();
+  } else {
+    txErrors++;
+    if (txErrorStreak < UINT8_MAX) {
+      txErrorStreak++;
+    }
+  }
+  if (trace) {
+    trace->record(ESPHostEMACTraceBase<Config>::SEND, iface, start, len, error, data);
+  }
+  return error;
+}
+
+/*
+ * With EtherType handlers registered, the frame is read into rawRxBuffer and its
+ * EtherType is checked. A frame for a handler is dispatched from rawRxBuffer
+ * without a buffer of the memory manager. Other frames are held in rawRxBuffer
+ * for heldInput. RX stays paused while a frame is held, so the handlers don't
+ * bypass the RX flow control and a frame for the stack isn't lost.
+ * Returns true if the frame was consumed.
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::rawInput(uint16_t size) {
+  raw_input_cb_t cb;
+  wifiLockMutex.lock();
+  espGetRx(rawRxBuffer, size);
+  uint16_t ethertype = (rawRxBuffer[Config::eth_type_offset] << 8) | rawRxBuffer[Config::eth_type_offset + 1];
+  for (unsigned i = 0; size >= Config::eth_header_size && i < rawHandlerCount; i++) {
+    if (rawHandlers[i].ethertype == ethertype) {
+      cb = rawHandlers[i].cb;
+      break;
+    }
+  }
+  if (!cb) {
+    rawRxHeld = this;
+    rawRxHeldSize = size;
+  }
+  wifiLockMutex.unlock();
+  if (!cb)
+    return false;
+
+  cb(rawRxBuffer, size);
+  return true;
+}
+
+/*
+ * Copies the frame held in rawRxBuffer into a buffer for the stack.
+ * If it can't be allocated, RX pauses and the frame stays held.
+ */
+template<class Transport, class Config>
+emac_mem_buf_t* ESPHostEMACBase<Transport, Config>::heldInput() {
+  emac_mem_buf_t* buf = allocRx(rawRxHeldSize);
+  if (buf == nullptr) {
+    rxFlowPause();
+    return nullptr;
+  }
+  memoryManager->copy_to_buf(buf, rawRxBuffer, rawRxHeldSize);
+  rawRxHeld = NULL;
+  return buf;
+}
+
+/**
+ * Sets a callback that needs to be called for packets received for that
+ * interface
+ *
+ * @param input_cb Function to be register as a callback
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_link_input_cb(emac_link_input_cb_t input_cb) {
+  emac_link_input_cb = input_cb;
+}
+
+/**
+ * Sets a callback that needs to be called on link status changes for given
+ * interface
+ *
+ * @param state_cb Function to be register as a callback
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_link_state_cb(emac_link_state_change_cb_t state_cb) {
+  emac_link_state_cb = state_cb;
+}
+
+/** Add device to a multicast group
+ *
+ * @param address  A multicast group hardware address
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::add_multicast_group(const uint8_t *address) {
+
+}
+
+/** Remove device from a multicast group
+ *
+ * @param address  A multicast group hardware address
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::remove_multicast_group(const uint8_t *address) {
+
+}
+
+/** Request reception of all multicast packets
+ *
+ * @param all True to receive all multicasts
+ *            False to receive only multicasts addressed to specified groups
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_all_multicast(bool all) {
+
+}
+
+/** Sets memory manager that is used to handle memory buffers
+ *
+ * @param mem_mngr Pointer to memory manager
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_memory_manager(EMACMemoryManager &mem_mngr) {
+  memoryManager = &mem_mngr;
+}
+
+/** Check if RX is paused because of memory pressure
+ *
+ * @return     true if frames are left queued in ESPHost until memory recovers
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::is_rx_paused(void) const {
+  return rxPaused;
+}
+
+/** Return how many times RX was paused because of memory pressure
+ *
+ * @return     count of RX pauses since power up
+ */
+template<class Transport, class Config>
+uint32_t ESPHostEMACBase<Transport, Config>::get_rx_pause_count(void) const {
+  return rxPauseCount;
+}
+
+/** Return the counters of the interface
+ *
+ * @param stats  Structure to fill with the counters
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::get_stats(ESPHostEMACStats &stats) const {
+  stats.rx_frames = rxFrames;
+  stats.rx_bytes = rxBytes;
+  stats.rx_pauses = rxPauseCount;
+  stats.tx_frames = txFrames;
+  stats.tx_bytes = txBytes;
+  stats.tx_errors = txErrors;
+  stats.wakeups = wakeupCount;
+}
+
+/** Register a handler for frames with an EtherType
+ *
+ * Matching received frames are passed to the handler and not to the IP stack.
+ * Registering a handler for an already registered EtherType replaces it.
+ *
+ * @param ethertype  EtherType in host byte order
+ * @param handler    Function to be called with the received frame
+ * @return           true on success, false if all handler slots are used
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::add_ethertype_handler(uint16_t ethertype, raw_input_cb_t handler) {
+  if (!handler)
+    return false;
+  bool ok = true;
+  wifiLockMutex.lock();
+  unsigned i = 0;
+  while (i < rawHandlerCount && rawHandlers[i].ethertype != ethertype) {
+    i++;
+  }
+  if (i < rawHandlerCount) {
+    rawHandlers[i].cb = handler;
+  } else if (rawHandlerCount < Config::raw_handlers_max) {
+    rawHandlers[rawHandlerCount].ethertype = ethertype;
+    rawHandlers[rawHandlerCount].cb = handler;
+    rawHandlerCount++;
+  } else {
+    ok = false;
+  }
+  wifiLockMutex.unlock();
+  return ok;
+}
+
+/** Unregister the handler for an EtherType
+ *
+ * @param ethertype  EtherType in host byte order
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::remove_ethertype_handler(uint16_t ethertype) {
+  wifiLockMutex.lock();
+  for (unsigned i = 0; i < rawHandlerCount; i++) {
+    if (rawHandlers[i].ethertype == ethertype) {
+      rawHandlerCount--;
+      rawHandlers[i] = rawHandlers[rawHandlerCount];
+      rawHandlers[rawHandlerCount].cb = nullptr;
+      break;
+    }
+  }
+  wifiLockMutex.unlock();
+}
+
+/** Sends a raw Ethernet frame over the link bypassing the IP stack
+ *
+ * The frame must contain the Ethernet header. That can not be called from an interrupt context.
+ *
+ * @param frame  Frame to be send
+ * @param len    Length of the frame in bytes
+ * @return       True if the frame was send successfully, False otherwise
+ */
+template<class Transport, class Config>
+bool ESPHostEMACBase<Transport, Config>::send_raw(const uint8_t *frame, uint16_t len) {
+  if (frame == NULL || len < Config::eth_header_size || len > Config::mtu_size + Config::eth_header_size)
+    return false;
+  if (recovering) {
+    txErrors++;
+    return false;
+  }
+  wifiLockMutex.lock();
+  int error = espSend(const_cast<uint8_t*>(frame), len);
+  wifiLockMutex.unlock();
+  wakeReceiveTask();
+  return (error == Transport::OK);
+}
+
+/** Sets a capture tap for the frames sent and received
+ *
+ * @param capture  Capture to record the frames, NULL to remove the tap
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_capture(ESPHostEMACCaptureBase<Config> *capture) {
+  wifiLockMutex.lock();
+  this->capture = capture;
+  wifiLockMutex.unlock();
+}
+
+/** Sets a trace to record the calls to ESPHost and their timing
+ *
+ * The trace records the calls of both interfaces.
+ *
+ * @param trace  Trace to record the calls, NULL to stop tracing
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_trace(ESPHostEMACTraceBase<Config> *trace) {
+  wifiLockMutex.lock();
+  ESPHostEMACBase::trace = trace;
+  wifiLockMutex.unlock();
+}
+
+/** Sets the periods of the receive task which services the ESP
+ *
+ * One receive task services the ESP for both interfaces.
+ * The idle period is used after Config::receive_idle_runs runs without traffic.
+ * Sending a packet while idle runs the receive task immediately.
+ *
+ * @param active  Period while there is traffic
+ * @param idle    Period while there is no traffic
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_receive_period(std::chrono::milliseconds active, std::chrono::milliseconds idle) {
+  wifiLockMutex.lock();
+  activePeriod = active;
+  idlePeriod = idle;
+  wifiLockMutex.unlock();
+}
+
+/** Return how many times the receive task woke up to service the ESP
+ *
+ * @return     count of receive task runs since power up
+ */
+template<class Transport, class Config>
+uint32_t ESPHostEMACBase<Transport, Config>::get_wakeup_count(void) {
+  return wakeupCount;
+}
+
+/** Return the RAM used by the EMACs
+ *
+ * The static memory with the worker thread and its stack, the statics of the
+ * transport and the objects of the created interfaces. The frames in the
+ * memory manager and a capture or trace set by the application are not included.
+ *
+ * @return     size in bytes
+ */
+template<class Transport, class Config>
+size_t ESPHostEMACBase<Transport, Config>::get_ram_footprint(void) {
+  return instanceCount * sizeof(ESPHostEMACBase) + sizeof(instanceCount) + sizeof(poweredUp) + sizeof(receiveTaskHandle)
+      + sizeof(receiveTaskActive) + sizeof(dataReadyPending)
+      + sizeof(txActivity) + sizeof(txExchanges) + sizeof(idleRuns) + sizeof(wakeupCount) + sizeof(activePeriod) + sizeof(idlePeriod)
+      + sizeof(lastExchange) + sizeof(txErrorStreak) + sizeof(recoveryCb) + sizeof(recovering) + sizeof(datapathHeapAllocs)
+      + sizeof(workerStack) + sizeof(rawRxBuffer) + sizeof(rawRxHeld) + sizeof(rawRxHeldSize) + sizeof(txBuffer) + sizeof(trace) + sizeof(wifiLockMutex)
+      + Transport::ram_footprint();
+}
+
+/** Return the count of heap allocations on the datapath
+ *
+ * Counts the buffers the EMAC allocates from the heap of the memory manager:
+ * the received frames and the aligned copies of chained or unaligned frames
+ * to send. With Config::static_alloc it stays 0. The messages ESPHost
+ * allocates for each frame are not counted, the EMAC doesn't control them.
+ *
+ * @return     count of heap allocations since power up
+ */
+template<class Transport, class Config>
+uint32_t ESPHostEMACBase<Transport, Config>::get_datapath_heap_allocs(void) {
+  return datapathHeapAllocs;
+}
+
+/** Sets the function to recover a not responding ESP
+ *
+ * If there was no successful exchange with the ESP for Config::health_timeout
+ * or after Config::health_tx_error_limit failed sends in a row, the receive task
+ * stops and the ESP is probed with a request in the worker thread of the transport.
+ * If the probe fails, the links are reported down and the function is called
+ * in the worker thread. Meanwhile sending fails without waiting for the ESP.
+ * If the function returns true, the restore function of each powered up
+ * interface is called, see set_restore_cb.
+ *
+ * @param recovery_cb  Function to reset and re-initialize the ESP, returns true on success
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_recovery_cb(mbed::Callback<bool()> recovery_cb) {
+  wifiLockMutex.lock();
+  recoveryCb = recovery_cb;
+  wifiLockMutex.unlock();
+}
+
+/** Sets the function to restore the interface after a recovery of the ESP
+ *
+ * Called in the worker thread after the ESP was reset and re-initialized,
+ * for example to rejoin the AP or to restart the SoftAP. The link is
+ * reported up if it returns true. Without it the link stays down.
+ *
+ * @param restore_cb  Function to restore the interface on the ESP, returns true on success
+ */
+template<class Transport, class Config>
+void ESPHostEMACBase<Transport, Config>::set_restore_cb(mbed::Callback<bool()> restore_cb) {
+  wifiLockMutex.lock();
+  restoreCb = restore_cb;
+  wifiLockMutex.unlock();
+}
+
+#endif
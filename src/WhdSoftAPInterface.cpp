@@ -0,0 +1,97 @@
+#include "WhdSoftAPInterface.h"
+#include "ESPHostEMACInterface.h"
+#include "CEspControl.h"
+
+WhdSoftAPInterface::WhdSoftAPInterface(ESPHostEMAC &emac, OnboardNetworkStack &stack) :
+    EMACInterface(emac, stack), isStarted(false), eventHandler(NULL), mutex(emac.wifiLockMutex) {
+
+  memset(&cfg, 0, sizeof(cfg));
+  emac.set_restore_cb(mbed::callback(this, &WhdSoftAPInterface::restore));
+}
+
+WhdSoftAPInterface* WhdSoftAPInterface::get_default_instance() {
+  static WhdSoftAPInterface softap;
+  return &softap;
+}
+
+int WhdSoftAPInterface::start(const char *ssid, const char *pass, nsapi_security_t security, uint8_t channel,
+    bool start_dhcp_server, const void *ie_info, bool ap_sta_concur) {
+  (void) start_dhcp_server;
+  (void) ie_info;
+  (void) ap_sta_concur;
+
+  if (isStarted)
+    return NSAPI_ERROR_IS_CONNECTED;
+  if ((ssid == NULL) || (strlen(ssid) == 0) || (strlen(ssid) > 32))
+    return NSAPI_ERROR_PARAMETER;
+  if (security != NSAPI_SECURITY_NONE && ((pass == NULL) || (strlen(pass) < 8) || (strlen(pass) > 63)))
+    return NSAPI_ERROR_PARAMETER;
+
+  if (!ESPHostEMACInterface::initHW())
+    return NSAPI_ERROR_DEVICE_ERROR;
+
+  memset(&cfg, 0, sizeof(cfg));
+  strncpy((char*) cfg.ssid, ssid, sizeof(cfg.ssid) - 1);
+  switch (security) {
+    case NSAPI_SECURITY_NONE:
+      cfg.encryption_mode = WIFI_AUTH_OPEN;
+      break;
+    case NSAPI_SECURITY_WPA_WPA2:
+      cfg.encryption_mode = WIFI_AUTH_WPA_WPA2_PSK;
+      break;
+    case NSAPI_SECURITY_WPA3_WPA2:
+      cfg.encryption_mode = WIFI_AUTH_WPA2_WPA3_PSK;
+      break;
+    default:
+      cfg.encryption_mode = WIFI_AUTH_WPA2_PSK;
+      break;
+  }
+  if (security != NSAPI_SECURITY_NONE) {
+    strncpy((char*) cfg.pwd, pass, sizeof(cfg.pwd) - 1);
+  }
+  cfg.channel = channel ? channel : 1;
+  cfg.max_connections = ESPHostEMACConfig::softap_max_connections;
+  cfg.ssid_hidden = false;
+  cfg.bandwidth = WIFI_BW_HT20;
+
+  mutex.lock();
+  int rv = CEspControl::getInstance().startSoftAccessPoint(cfg);
+  mutex.unlock();
+  if (rv != ESP_CONTROL_OK)
+    return NSAPI_ERROR_DEVICE_ERROR;
+
+  set_dhcp(false); // the SoftAP has a static address set with set_network
+  nsapi_error_t ret = EMACInterface::connect();
+  if (ret != NSAPI_ERROR_OK && ret != NSAPI_ERROR_IS_CONNECTED) {
+    mutex.lock();
+    CEspControl::getInstance().stopSoftAccessPoint();
+    mutex.unlock();
+    return ret;
+  }
+  isStarted = true;
+  return NSAPI_ERROR_OK;
+}
+
+/*
+ * Called by the EMAC after a recovery of the ESP, if the SoftAP EMAC is powered up.
+ * The reset ESP doesn't run the SoftAP, so it is started again with the same configuration.
+ */
+bool WhdSoftAPInterface::restore() {
+  if (!isStarted)
+    return false;
+  mutex.lock();
+  int rv = CEspControl::getInstance().startSoftAccessPoint(cfg);
+  mutex.unlock();
+  return (rv == ESP_CONTROL_OK);
+}
+
+int WhdSoftAPInterface::stop(void) {
+  if (!isStarted)
+    return NSAPI_ERROR_NO_CONNECTION;
+  isStarted = false;
+  EMACInterface::disconnect();
+  mutex.lock();
+  int rv = CEspControl::getInstance().stopSoftAccessPoint();
+  mutex.unlock();
+  return (rv == ESP_CONTROL_OK) ? NSAPI_ERROR_OK : NSAPI_ERROR_DEVICE_ERROR;
+}
@@ -1,5 +1,4 @@
-
-// a fake WhdSoftAPInterface for the Mbed Core WiFi library to compile
+// WhdSoftAPInterface for the Mbed Core WiFi library, implemented over the ESPHost SoftAP
 
 #ifndef WHD_SOFTAP_INTERFACE_H
 #define WHD_SOFTAP_INTERFACE_H
@@ -47,24 +46,61 @@ struct whd_event_header_t
 typedef void *(*whd_event_handler_t)(whd_interface_t ifp, const whd_event_header_t *event_header,
                                      const uint8_t *event_data, void *handler_user_data);
 
+/** WhdSoftAPInterface class
+ *  SoftAP interface over ESPHost. It uses its own ESPHostEMAC, so it can run
+ *  concurrently with the station interface.
+ */
 class WhdSoftAPInterface : public EMACInterface {
 public:
 
-    WhdSoftAPInterface(ESPHostEMAC &emac = ESPHostEMAC::get_instance(),
+    WhdSoftAPInterface(ESPHostEMAC &emac = ESPHostEMAC::get_softap_instance(),
                        OnboardNetworkStack &stack = OnboardNetworkStack::get_default_instance());
 
     static WhdSoftAPInterface *get_default_instance();
 
+    /** Start the SoftAP
+     *
+     *  The IP address has to be set with set_network before. There is no DHCP server
+     *  in the Mbed network stack, so start_dhcp_server is ignored. ie_info is not supported.
+     *  The SoftAP can be up together with the station interface.
+     *
+     *  @param ssid      Name of the network
+     *  @param pass      Security passphrase of the network
+     *  @param security  Type of encryption
+     *  @param channel   Channel of the network
+     *  @return          0 on success, or error code on failure
+     */
     int start(const char *ssid, const char *pass, nsapi_security_t security, uint8_t channel,
               bool start_dhcp_server = true, const void *ie_info = NULL, bool ap_sta_concur = false);
 
-    int stop(void) {return 1;}
+    /** Stop the SoftAP
+     *
+     *  @return          0 on success, or error code on failure
+     */
+    int stop(void);
 
-    int get_associated_client_list(void *client_list_buffer, uint16_t buffer_length);
+    int get_associated_client_list(void *client_list_buffer, uint16_t buffer_length) {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
 
-    int register_event_handler(whd_event_handler_t softap_event_handler);
+    /** Register the handler of the SoftAP events
+     *
+     *  The WiFi library of the Mbed Core registers a handler in WiFi.beginAP and
+     *  fails if that fails. The handler is stored, but not called, because ESPHost
+     *  doesn't report the association of clients.
+     *
+     *  @param softap_event_handler  Handler of the events
+     *  @return          0 on success
+     */
+    int register_event_handler(whd_event_handler_t softap_event_handler) {
+        eventHandler = softap_event_handler;
+        return NSAPI_ERROR_OK;
+    }
 
-    int unregister_event_handler(void) {return 1;}
+    int unregister_event_handler(void) {
+        eventHandler = NULL;
+        return NSAPI_ERROR_OK;
+    }
 
     nsapi_error_t set_blocking(bool blocking)
     {
@@ -75,6 +111,14 @@ public:
             return NSAPI_ERROR_UNSUPPORTED;
         }
     }
+
+private:
+    bool isStarted;
+    whd_event_handler_t eventHandler;
+    SoftApCfg_t cfg; // to restart the SoftAP after a recovery of the ESP
+    rtos::Mutex& mutex;
+
+    bool restore();
 };
 
 #endif